@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "CWPlayer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CW_AXES_SSE2 1
+	#include <emmintrin.h>
+#endif
+
+namespace CWTeams
+{
+
+	//The weighted overall rating followed by PVP, gamesense and teamwork
+	static const int AXIS_COUNT = 4;
+
+	//One value per axis as scaled integers, laid out so that all four fit in a single SSE register
+	struct alignas(16) AxisVector
+	{
+		std::int32_t Lanes[AXIS_COUNT];
+	};
+
+	//Lane-wise operations on AxisVectors. Uses SSE2 where available and plain loops everywhere else
+	class Axes
+	{
+	public:
+		static AxisVector Fill(std::int32_t value)
+		{
+			return { { value, value, value, value } };
+		}
+
+		//Adds up the axis ratings of everyone on team
+		static AxisVector Sum(const std::vector<AxisVector>& ratings, const Team& team)
+		{
+#ifdef CW_AXES_SSE2
+			__m128i sum = _mm_setzero_si128();
+			for (auto playerID : team)
+			{
+				sum = _mm_add_epi32(sum, Load(ratings[playerID]));
+			}
+			return Store(sum);
+#else
+			AxisVector sum = Fill(0);
+			for (auto playerID : team)
+			{
+				for (int i = 0; i < AXIS_COUNT; i++) sum.Lanes[i] += ratings[playerID].Lanes[i];
+			}
+			return sum;
+#endif
+		}
+
+		//True if min <= value <= max on every axis
+		static bool InRange(const AxisVector& value, const AxisVector& min, const AxisVector& max)
+		{
+#ifdef CW_AXES_SSE2
+			__m128i v = Load(value);
+			__m128i outside = _mm_or_si128(_mm_cmpgt_epi32(Load(min), v), _mm_cmpgt_epi32(v, Load(max)));
+			return _mm_movemask_epi8(outside) == 0;
+#else
+			for (int i = 0; i < AXIS_COUNT; i++)
+			{
+				if (value.Lanes[i] < min.Lanes[i] || value.Lanes[i] > max.Lanes[i]) return false;
+			}
+			return true;
+#endif
+		}
+
+		//Grows [low, high] to include value on every axis
+		static void Widen(AxisVector& low, AxisVector& high, const AxisVector& value)
+		{
+#ifdef CW_AXES_SSE2
+			//SSE2 has no 32 bit min and max, so blend with the comparison mask instead
+			__m128i v = Load(value), l = Load(low), h = Load(high);
+			__m128i below = _mm_cmpgt_epi32(l, v), above = _mm_cmpgt_epi32(v, h);
+			low = Store(_mm_or_si128(_mm_and_si128(below, v), _mm_andnot_si128(below, l)));
+			high = Store(_mm_or_si128(_mm_and_si128(above, v), _mm_andnot_si128(above, h)));
+#else
+			for (int i = 0; i < AXIS_COUNT; i++)
+			{
+				if (value.Lanes[i] < low.Lanes[i]) low.Lanes[i] = value.Lanes[i];
+				if (value.Lanes[i] > high.Lanes[i]) high.Lanes[i] = value.Lanes[i];
+			}
+#endif
+		}
+
+		static AxisVector Subtract(const AxisVector& a, const AxisVector& b)
+		{
+#ifdef CW_AXES_SSE2
+			return Store(_mm_sub_epi32(Load(a), Load(b)));
+#else
+			AxisVector result;
+			for (int i = 0; i < AXIS_COUNT; i++) result.Lanes[i] = a.Lanes[i] - b.Lanes[i];
+			return result;
+#endif
+		}
+
+		//True if a is no worse than b on every axis and better on at least one. Lower is better
+		static bool Dominates(const AxisVector& a, const AxisVector& b)
+		{
+#ifdef CW_AXES_SSE2
+			__m128i va = Load(a), vb = Load(b);
+			return _mm_movemask_epi8(_mm_cmpgt_epi32(va, vb)) == 0 && _mm_movemask_epi8(_mm_cmpeq_epi32(va, vb)) != 0xFFFF;
+#else
+			bool better = false;
+			for (int i = 0; i < AXIS_COUNT; i++)
+			{
+				if (a.Lanes[i] > b.Lanes[i]) return false;
+				if (a.Lanes[i] < b.Lanes[i]) better = true;
+			}
+			return better;
+#endif
+		}
+
+	private:
+#ifdef CW_AXES_SSE2
+		static __m128i Load(const AxisVector& value) { return _mm_load_si128(reinterpret_cast<const __m128i*>(value.Lanes)); }
+		static AxisVector Store(__m128i value)
+		{
+			AxisVector result;
+			_mm_store_si128(reinterpret_cast<__m128i*>(result.Lanes), value);
+			return result;
+		}
+#endif
+
+	};
+}
@@ -0,0 +1,184 @@
+#include "BatchRunner.h"
+#include "TeamBalancer.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+
+namespace CWTeams
+{
+
+	bool BatchRunner::ParseScenario(const std::string& line, GenParameters& params, std::string& name, std::string& outputFile, std::string& error)
+	{
+		std::stringstream tokens(line);
+		std::string token;
+		while (tokens >> token)
+		{
+			std::size_t equals = token.find('=');
+			if (equals == std::string::npos)
+			{
+				error = "Expected key=value but got \"" + token + "\"";
+				return false;
+			}
+			std::string key(token, 0, equals), value(token, equals + 1);
+			try
+			{
+				if (key == "name") name = value;
+				else if (key == "output") outputFile = value;
+				else if (key == "teams") params.TeamCount = std::stoi(value);
+				else if (key == "max-deviation") params.MaxDev = std::stod(value);
+				else if (key == "limit") params.LimitOutput = std::stoi(value);
+				else if (key == "sort") params.Sort = value == "true";
+				else if (key == "timeout") params.TimeoutSeconds = std::stoi(value);
+				else if (key == "stop-coverage") params.StopCoverage = std::stod(value);
+				else if (key == "count-only") params.CountOnly = value == "true";
+				else if (key == "precision") params.Precision = std::stoi(value);
+				else if (key == "fixed-point") params.FixedPoint = value == "true";
+				else if (key == "engine") params.Engine = value;
+				else if (key == "axis-deviation")
+				{
+					if (!GenerateTeams::ParseAxisDeviation(value, params.AxisDeviation)) throw std::invalid_argument(value);
+				}
+				else if (key == "pareto") params.Pareto = value == "true";
+				else if (key == "history-weight") params.HistoryWeight = std::stod(value);
+				else if (key == "max-repeats") params.MaxRepeats = std::stol(value);
+				else if (key == "diverse") params.Diverse = std::stoi(value);
+				else if (key == "size-slack") params.SizeSlack = std::stoi(value);
+				else if (key == "format")
+				{
+					if (!OutputWriter::ParseFormat(value, params.Format)) throw std::invalid_argument(value);
+				}
+				else if (key == "threads") params.Threads = std::stoi(value);
+				else if (key == "seed") params.Seed = std::stoull(value);
+				else if (key == "separate")
+				{
+					params.Separations.clear();
+					std::stringstream pairs(value);
+					std::string pair;
+					while (std::getline(pairs, pair, ','))
+					{
+						if (!pair.empty()) params.Separations.push_back(pair);
+					}
+				}
+				else
+				{
+					error = "Unknown key \"" + key + "\"";
+					return false;
+				}
+			}
+			catch (std::exception& e)
+			{
+				error = "Invalid value for " + key + ": \"" + value + "\"";
+				return false;
+			}
+		}
+
+		if (params.TeamCount <= 0)
+		{
+			error = "teams must be at least 1";
+			return false;
+		}
+		if (params.Precision < 0 || params.Precision > 9)
+		{
+			error = "precision must be between 0 and 9";
+			return false;
+		}
+		if (!GenerateTeams::IsKnownEngine(params.Engine))
+		{
+			error = "Unknown engine \"" + params.Engine + "\"";
+			return false;
+		}
+		return true;
+	}
+
+	bool BatchRunner::Run(const GenParameters& defaults, const std::string& jobFile)
+	{
+		std::ifstream in(jobFile);
+		if (!in)
+		{
+			CW_FATAL("Failed to open job file \"{}\"", jobFile);
+		}
+
+		std::vector<Scenario> scenarios;
+		int failed = 0;
+		std::string line;
+		for (int lineNumber = 1; std::getline(in, line); lineNumber++)
+		{
+			std::size_t first = line.find_first_not_of(" \t\r");
+			if (first == std::string::npos || line[first] == '#') continue;
+
+			Scenario scenario { "scenario" + std::to_string(scenarios.size() + failed + 1), "", defaults };
+			//Scenarios run side by side so they don't get to use every core each
+			scenario.Params.Threads = 1;
+			//Each draws from its own random stream, so scenarios that share a seed don't all find the same team sets
+			scenario.Params.Stream = static_cast<int>(scenarios.size());
+			//A scenario that can't run is reported and skipped here, before any worker could exit the program over it
+			std::string error;
+			scenario.Params.Restrictions.clear();
+			if (!ParseScenario(line, scenario.Params, scenario.Name, scenario.OutputFile, error) || !TeamBalancer::Validate(scenario.Params, error)
+				|| !PlayerRestrictor::TryRestrict(scenario.Params.Players, scenario.Params.Separations, scenario.Params.Restrictions, error))
+			{
+				CW_ERROR("Skipping scenario {} on line {} of {}: {}", scenario.Name, lineNumber, jobFile, error);
+				failed++;
+				continue;
+			}
+			if (scenario.OutputFile.empty())
+			{
+				scenario.OutputFile = scenario.Name + ".txt";
+			}
+			scenarios.push_back(std::move(scenario));
+		}
+
+		int threadCount = std::max(1, std::min(defaults.Threads, static_cast<int>(scenarios.size())));
+		CW_INFO("Running {} scenarios from {} using {} threads", scenarios.size(), jobFile, threadCount);
+		auto start = std::chrono::steady_clock::now();
+
+		std::atomic<std::size_t> next { 0 };
+		auto work = [&scenarios, &next]()
+		{
+			for (std::size_t i = next++; i < scenarios.size(); i = next++)
+			{
+				RunScenario(scenarios[i]);
+			}
+		};
+		std::vector<std::thread> threads;
+		for (int i = 1; i < threadCount; i++)
+		{
+			threads.emplace_back(work);
+		}
+		work();
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+		CW_SUCCESS("Finished {} scenarios in {} seconds", scenarios.size(), seconds);
+		if (failed > 0)
+		{
+			CW_ERROR("{} scenarios in {} failed and were skipped", failed, jobFile);
+		}
+		return failed == 0;
+	}
+
+	void BatchRunner::RunScenario(Scenario& scenario)
+	{
+		FILE* output = fopen(scenario.OutputFile.c_str(), "w");
+		if (!output)
+		{
+			CW_ERROR("Skipping scenario {} because its output file \"{}\" couldn't be opened", scenario.Name, scenario.OutputFile);
+			return;
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		CW_INFO("Starting scenario {}: {} teams, max deviation +-{}", scenario.Name, scenario.Params.TeamCount, scenario.Params.MaxDev);
+		scenario.Params.Output = output;
+		GenerateTeams::Run(scenario.Params);
+		fclose(output);
+
+		double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+		CW_SUCCESS("Finished scenario {} in {} seconds. Results written to {}", scenario.Name, seconds, scenario.OutputFile);
+	}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "GenerateTeams.h"
+
+namespace CWTeams
+{
+
+	//Runs many scenarios against a roster and weights that were only loaded once.
+	//Each line of a job file is one scenario made of key=value pairs that override the command line arguments, for example:
+	//name=trios teams=3 max-deviation=1.5 separate=troy:chas,a:b output=trios.txt
+	class BatchRunner
+	{
+	public:
+		//Returns false if any scenario was invalid and had to be skipped
+		static bool Run(const GenParameters& defaults, const std::string& jobFile);
+
+		//Applies the key=value pairs in line on top of params. Returns false and fills in error if the line is invalid
+		static bool ParseScenario(const std::string& line, GenParameters& params, std::string& name, std::string& outputFile, std::string& error);
+
+	private:
+		struct Scenario
+		{
+			std::string Name;
+			std::string OutputFile;
+			GenParameters Params;
+		};
+
+		static void RunScenario(Scenario& scenario);
+
+	};
+}
@@ -0,0 +1,133 @@
+#include "CountTeams.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+namespace CWTeams
+{
+
+	std::size_t CountTeams::StateHash::operator()(const State& state) const
+	{
+		std::uint64_t hash = 1469598103934665603ULL;
+		for (std::int64_t value : state)
+		{
+			hash ^= static_cast<std::uint64_t>(value);
+			hash *= 1099511628211ULL;
+			hash ^= hash >> 29;
+		}
+		return static_cast<std::size_t>(hash);
+	}
+
+	std::uint64_t CountTeams::Count(GenParameters& params, bool& exact)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		GenData data { params.Players, params.Restrictions, params.Output };
+		GenerateTeams::Setup(params, data);
+		if (!data.Restrictions.empty())
+		{
+			CW_WARN("Player separations are not taken into account when counting team sets");
+		}
+
+		CW_INFO("Counting team sets using ratings quantized to {} decimal places", params.Precision);
+
+		//Placing the strongest players first lets the bounds below prune partial teams sooner
+		std::vector<FixedRating> ratings = data.FixedRatings;
+		std::sort(ratings.begin(), ratings.end(), std::greater<FixedRating>());
+
+		const int playerCount = static_cast<int>(ratings.size());
+		const int teamCount = static_cast<int>(data.Sizes.size());
+		const FixedRating minSum = data.MinFixedTeamStrength;
+		const FixedRating maxSum = data.MaxFixedTeamStrength;
+
+		//Teams of the same size are interchangeable, so group them together
+		TeamSizes sizes = data.Sizes;
+		std::sort(sizes.begin(), sizes.end(), std::greater<std::uint8_t>());
+		std::vector<int> groupEnd(teamCount);
+		for (int t = teamCount - 1; t >= 0; t--)
+		{
+			groupEnd[t] = (t + 1 < teamCount && sizes[t + 1] == sizes[t]) ? groupEnd[t + 1] : t + 1;
+		}
+		std::vector<int> groupStart(teamCount);
+		for (int t = 0; t < teamCount; t++)
+		{
+			groupStart[t] = (t > 0 && sizes[t - 1] == sizes[t]) ? groupStart[t - 1] : t;
+		}
+
+		//The smallest and largest rating among the players that are still unassigned after each step
+		std::vector<FixedRating> minAfter(playerCount + 1, 0), maxAfter(playerCount + 1, 0);
+		for (int i = playerCount - 1; i >= 0; i--)
+		{
+			bool last = i == playerCount - 1;
+			minAfter[i] = last ? ratings[i] : std::min(ratings[i], minAfter[i + 1]);
+			maxAfter[i] = last ? ratings[i] : std::max(ratings[i], maxAfter[i + 1]);
+		}
+
+		//Counts of team sets for every reachable combination of partial team sums and sizes. A player that starts a team always goes to the
+		//first empty one of its size, so the same size teams are told apart by their first player and each set is counted once
+		std::unordered_map<State, std::uint64_t, StateHash> current, next;
+		current[State(teamCount, Pack(0, 0))] = 1;
+		std::size_t peakStates = 1;
+
+		for (int i = 0; i < playerCount; i++)
+		{
+			next.clear();
+			FixedRating rating = ratings[i];
+			for (const auto& entry : current)
+			{
+				const State& state = entry.first;
+				for (int t = 0; t < teamCount; t++)
+				{
+					int count = GetCount(state[t]);
+					if (count == sizes[t]) continue;
+					//Identical teams of the same size lead to the same canonical state, so only expand the first one
+					if (t != groupStart[t] && state[t] == state[t - 1]) continue;
+
+					std::uint64_t multiplicity = 1;
+					while (count > 0 && t + multiplicity < groupEnd[t] && state[t + multiplicity] == state[t]) multiplicity++;
+
+					FixedRating sum = GetSum(state[t]) + rating;
+					int open = sizes[t] - (count + 1);
+					if (open == 0)
+					{
+						if (sum < minSum || sum > maxSum) continue;
+					}
+					else
+					{
+						//Even the weakest or strongest remaining players can't bring this team back into range
+						if (sum + open * minAfter[i + 1] > maxSum) continue;
+						if (sum + open * maxAfter[i + 1] < minSum) continue;
+					}
+
+					State nextState = state;
+					nextState[t] = Pack(sum, count + 1);
+					std::sort(nextState.begin() + groupStart[t], nextState.begin() + groupEnd[t]);
+					std::uint64_t& target = next[nextState];
+					target = SaturatingAdd(target, SaturatingMul(entry.second, multiplicity));
+				}
+			}
+			std::swap(current, next);
+			peakStates = std::max(peakStates, current.size());
+		}
+
+		//Every surviving state has all teams full and in range. A saturated count is still below the real one,
+		//and the summaries hold counts as signed 64 bit values
+		std::uint64_t result = 0;
+		for (const auto& entry : current) result = SaturatingAdd(result, entry.second);
+		exact = result <= static_cast<std::uint64_t>(INT64_MAX);
+		result = std::min(result, static_cast<std::uint64_t>(INT64_MAX));
+
+		double seconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000000.0;
+		if (exact)
+		{
+			CW_SUCCESS("Counted exactly {} valid team sets in {} seconds ({} peak DP states)", result, seconds, peakStates);
+		}
+		else
+		{
+			CW_ERROR("There are more valid team sets than fit in 63 bits, only at least {} can be reported ({} seconds, {} peak DP states)", result, seconds, peakStates);
+		}
+		if (params.Output) fprintf(params.Output, "%s%llu\n", exact ? "" : ">=", static_cast<unsigned long long>(result));
+		return result;
+	}
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "GenerateTeams.h"
+#include "FixedPoint.h"
+
+namespace CWTeams
+{
+
+	//Counts how many valid team sets exist without listing any of them
+	class CountTeams
+	{
+	public:
+		//The count is cleared from exact when there are too many team sets to count in 63 bits, and a lower bound is returned instead
+		static std::uint64_t Count(GenParameters& params, bool& exact);
+
+	private:
+		//One packed (sum, count) entry per team, with teams of the same size kept sorted so that permutations of them collapse into one state
+		using State = std::vector<std::int64_t>;
+
+		struct StateHash
+		{
+			std::size_t operator()(const State& state) const;
+		};
+
+		static std::int64_t Pack(FixedRating sum, int count) { return sum * 256 + count; }
+		static int GetCount(std::int64_t packed) { return static_cast<int>(packed & 255); }
+		static FixedRating GetSum(std::int64_t packed) { return (packed - GetCount(packed)) / 256; }
+
+		//Counts stop at the largest 64 bit value instead of wrapping, so an overflowed count is still a lower bound
+		static std::uint64_t SaturatingAdd(std::uint64_t a, std::uint64_t b) { return a > UINT64_MAX - b ? UINT64_MAX : a + b; }
+		static std::uint64_t SaturatingMul(std::uint64_t a, std::uint64_t b) { return b != 0 && a > UINT64_MAX / b ? UINT64_MAX : a * b; }
+
+	};
+}
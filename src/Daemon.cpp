@@ -0,0 +1,345 @@
+#include "Daemon.h"
+
+#include "BatchRunner.h"
+#include "RatingsReader.h"
+#include "TeamBalancer.h"
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+
+#ifndef _WIN32
+	#include <sys/socket.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+	#include <signal.h>
+#endif
+
+namespace CWTeams
+{
+
+#ifdef _WIN32
+
+	void Daemon::Serve(const std::string& socketPath, const std::string& cwFile, const std::string& weightsFile, const GenParameters& defaults)
+	{
+		CW_FATAL("Daemon mode needs Unix domain sockets which aren't supported on this platform");
+	}
+
+	bool Daemon::Request(const std::string& socketPath, const std::string& request, FILE* output)
+	{
+		CW_FATAL("Daemon mode needs Unix domain sockets which aren't supported on this platform");
+		return false;
+	}
+
+#else
+
+	static bool OpenSocket(const std::string& socketPath, int& result, sockaddr_un& address)
+	{
+		if (socketPath.size() >= sizeof(address.sun_path))
+		{
+			CW_ERROR("Socket path \"{}\" is too long", socketPath);
+			return false;
+		}
+		result = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (result < 0)
+		{
+			CW_ERROR("Failed to create socket: {}", strerror(errno));
+			return false;
+		}
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+		return true;
+	}
+
+	void Daemon::Serve(const std::string& socketPath, const std::string& cwFile, const std::string& weightsFile, const GenParameters& defaults)
+	{
+		State state;
+		state.CWFile = cwFile;
+		state.WeightsFile = weightsFile;
+		state.Defaults = defaults;
+
+		int server;
+		sockaddr_un address;
+		if (!OpenSocket(socketPath, server, address))
+		{
+			CW_FATAL("Failed to start daemon");
+		}
+		unlink(socketPath.c_str());
+		if (bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(server, 16) != 0)
+		{
+			CW_FATAL("Failed to listen on \"{}\": {}", socketPath, strerror(errno));
+		}
+		//A client hanging up early must not kill the daemon
+		signal(SIGPIPE, SIG_IGN);
+
+		//Searches can take a while, so a fixed pool of workers answers them while this thread keeps accepting
+		const int workerCount = std::max(1, defaults.Threads);
+		std::vector<std::thread> workers;
+		for (int i = 0; i < workerCount; i++)
+		{
+			workers.emplace_back(RunWorker, std::ref(state));
+		}
+		CW_SUCCESS("Serving balance requests on \"{}\" with {} workers", socketPath, workerCount);
+
+		while (true)
+		{
+			int client = accept(server, nullptr, nullptr);
+			if (client < 0)
+			{
+				if (errno == EINTR) continue;
+				CW_ERROR("Failed to accept connection: {}", strerror(errno));
+				break;
+			}
+
+			std::string request;
+			if (!ReadLine(client, request))
+			{
+				close(client);
+				continue;
+			}
+			if (request == "stop")
+			{
+				WriteAll(client, "OK 0\n");
+				close(client);
+				break;
+			}
+			if (request == "reload")
+			{
+				std::string error;
+				WriteAll(client, Reload(state, error) ? "OK 0\n" : "ERR " + error + "\n");
+				close(client);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> guard(state.QueueLock);
+			if (state.Queue.size() >= MAX_QUEUED_REQUESTS)
+			{
+				guard.unlock();
+				WriteAll(client, "ERR Too many requests are waiting, try again later\n");
+				close(client);
+				continue;
+			}
+			state.Queue.emplace_back(client, std::move(request));
+			guard.unlock();
+			state.Wake.notify_one();
+		}
+
+		close(server);
+		unlink(socketPath.c_str());
+		//The workers answer everything still queued before they stop, then their state can go away
+		{
+			std::lock_guard<std::mutex> guard(state.QueueLock);
+			state.Stopping = true;
+		}
+		state.Wake.notify_all();
+		for (auto& worker : workers)
+		{
+			worker.join();
+		}
+		CW_INFO("Daemon stopped");
+	}
+
+	void Daemon::RunWorker(State& state)
+	{
+		while (true)
+		{
+			std::pair<int, std::string> next;
+			{
+				std::unique_lock<std::mutex> guard(state.QueueLock);
+				state.Wake.wait(guard, [&state]() { return state.Stopping || !state.Queue.empty(); });
+				if (state.Queue.empty()) return;
+				next = std::move(state.Queue.front());
+				state.Queue.pop_front();
+			}
+			HandleRequest(state, next.first, next.second);
+		}
+	}
+
+	bool Daemon::Request(const std::string& socketPath, const std::string& request, FILE* output)
+	{
+		int server;
+		sockaddr_un address;
+		if (!OpenSocket(socketPath, server, address)) return false;
+		if (connect(server, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+		{
+			CW_ERROR("Failed to connect to \"{}\": {}", socketPath, strerror(errno));
+			close(server);
+			return false;
+		}
+		signal(SIGPIPE, SIG_IGN);
+
+		std::string header;
+		if (!WriteAll(server, request + "\n") || !ReadLine(server, header))
+		{
+			CW_ERROR("Lost connection to the daemon");
+			close(server);
+			return false;
+		}
+		if (header.rfind("OK ", 0) != 0)
+		{
+			CW_ERROR("Daemon returned: {}", header);
+			close(server);
+			return false;
+		}
+
+		std::size_t remaining = std::stoull(header.substr(3));
+		char buffer[64 * 1024];
+		while (remaining > 0)
+		{
+			ssize_t read = recv(server, buffer, std::min(remaining, sizeof(buffer)), 0);
+			if (read <= 0) break;
+			fwrite(buffer, 1, read, output);
+			remaining -= read;
+		}
+		close(server);
+		return remaining == 0;
+	}
+
+	bool Daemon::Reload(State& state, std::string& error)
+	{
+		std::string cwFile, weightsFile;
+		std::vector<std::string> separations;
+		{
+			std::lock_guard<std::mutex> guard(state.Lock);
+			cwFile = state.CWFile;
+			weightsFile = state.WeightsFile;
+			separations = state.Defaults.Separations;
+		}
+		CW_INFO("Reloading \"{}\" and \"{}\"", cwFile, weightsFile);
+
+		//Requests keep being answered from the old roster and weights until the new ones are known to be good
+		Weights weights;
+		std::vector<CWPlayer> players;
+		std::vector<std::shared_ptr<PlayerRestriction>> restrictions;
+		if (!Weights::TryLoad(weightsFile, weights, error) || !RatingsReader::TryParsePlayers(cwFile, players, error)
+			|| !PlayerRestrictor::TryRestrict(players, separations, restrictions, error))
+		{
+			CW_ERROR("Reload failed, keeping the old roster and weights: {}", error);
+			return false;
+		}
+
+		std::lock_guard<std::mutex> guard(state.Lock);
+		state.Defaults.WeightsMap = std::move(weights);
+		state.Defaults.Players = std::move(players);
+		state.Defaults.Restrictions = std::move(restrictions);
+		state.Restrictions.clear();
+		state.Responses.clear();
+		return true;
+	}
+
+	void Daemon::HandleRequest(State& state, int client, const std::string& request)
+	{
+		auto start = std::chrono::steady_clock::now();
+		std::string response, error;
+		if (Process(state, request, response, error))
+		{
+			WriteAll(client, "OK " + std::to_string(response.size()) + "\n");
+			WriteAll(client, response);
+		}
+		else
+		{
+			WriteAll(client, "ERR " + error + "\n");
+		}
+		close(client);
+		double milliseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+		CW_INFO("Answered \"{}\" in {} ms", request, milliseconds);
+	}
+
+	bool Daemon::Process(State& state, const std::string& request, std::string& response, std::string& error)
+	{
+		std::string key = GetCacheKey(request);
+		GenParameters params;
+		{
+			std::lock_guard<std::mutex> guard(state.Lock);
+			auto cached = state.Responses.find(key);
+			if (cached != state.Responses.end())
+			{
+				response = cached->second;
+				return true;
+			}
+			params = state.Defaults;
+		}
+
+		std::string name, outputFile;
+		if (!BatchRunner::ParseScenario(request, params, name, outputFile, error)) return false;
+
+		//Everything that would normally end the program has to be caught here instead
+		if (!TeamBalancer::Validate(params, error)) return false;
+
+		{
+			std::lock_guard<std::mutex> guard(state.Lock);
+			auto compiled = state.Restrictions.find(params.Separations);
+			if (compiled == state.Restrictions.end())
+			{
+				std::vector<std::shared_ptr<PlayerRestriction>> restrictions;
+				PlayerRestrictor::Restrict(params.Players, params.Separations, restrictions);
+				compiled = state.Restrictions.emplace(params.Separations, std::move(restrictions)).first;
+			}
+			params.Restrictions = compiled->second;
+		}
+
+		char* buffer = nullptr;
+		std::size_t size = 0;
+		params.Output = open_memstream(&buffer, &size);
+		if (!params.Output)
+		{
+			error = "Out of memory";
+			return false;
+		}
+		GenerateTeams::Run(params);
+		fclose(params.Output);
+		response.assign(buffer, size);
+		free(buffer);
+
+		std::lock_guard<std::mutex> guard(state.Lock);
+		if (state.Responses.size() >= MAX_CACHED_RESPONSES) state.Responses.clear();
+		state.Responses[key] = response;
+		return true;
+	}
+
+	std::string Daemon::GetCacheKey(const std::string& request)
+	{
+		//The same pairs in a different order are the same request
+		std::stringstream tokens(request);
+		std::vector<std::string> pairs;
+		std::string token;
+		while (tokens >> token) pairs.push_back(token);
+		std::sort(pairs.begin(), pairs.end());
+
+		std::string key;
+		for (const auto& pair : pairs) key += pair + " ";
+		return key;
+	}
+
+	bool Daemon::ReadLine(int socket, std::string& line)
+	{
+		line.clear();
+		char c;
+		while (true)
+		{
+			ssize_t read = recv(socket, &c, 1, 0);
+			if (read <= 0) return false;
+			if (c == '\n') break;
+			if (c != '\r') line += c;
+		}
+		return true;
+	}
+
+	bool Daemon::WriteAll(int socket, const std::string& data)
+	{
+		std::size_t written = 0;
+		while (written < data.size())
+		{
+			ssize_t result = send(socket, data.data() + written, data.size() - written, 0);
+			if (result <= 0) return false;
+			written += result;
+		}
+		return true;
+	}
+
+#endif
+
+}
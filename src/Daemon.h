@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <deque>
+#include <condition_variable>
+
+#include "GenerateTeams.h"
+
+namespace CWTeams
+{
+
+	//Keeps the roster, weights, compiled restrictions and recent answers in memory and serves balance requests over a Unix domain socket.
+	//A request is one line of the same key=value pairs a batch job file uses, or one of the commands "reload" and "stop".
+	//The response is a header line, "OK <length>" or "ERR <message>", followed by length bytes of the usual text output
+	class Daemon
+	{
+	public:
+		static void Serve(const std::string& socketPath, const std::string& cwFile, const std::string& weightsFile, const GenParameters& defaults);
+
+		//Sends one request to a running daemon and writes the response body to output. Returns false if the request failed
+		static bool Request(const std::string& socketPath, const std::string& request, FILE* output);
+
+	private:
+		struct State
+		{
+			std::mutex Lock;
+			std::string CWFile, WeightsFile;
+			GenParameters Defaults;
+			//Compiled restrictions keyed by their separation strings
+			std::map<std::vector<std::string>, std::vector<std::shared_ptr<PlayerRestriction>>> Restrictions;
+			//Finished responses keyed by the request with its pairs sorted
+			std::map<std::string, std::string> Responses;
+
+			//Connections waiting for one of the worker threads, along with their requests
+			std::mutex QueueLock;
+			std::condition_variable Wake;
+			std::deque<std::pair<int, std::string>> Queue;
+			bool Stopping = false;
+		};
+
+		//How many finished responses are remembered before the cache is cleared
+		static const std::size_t MAX_CACHED_RESPONSES = 256;
+		//How many requests may wait for a worker before new ones are turned away
+		static const std::size_t MAX_QUEUED_REQUESTS = 64;
+
+		//Loads the workbooks again, keeping the old roster and weights if either can't be read
+		static bool Reload(State& state, std::string& error);
+		static void RunWorker(State& state);
+		static void HandleRequest(State& state, int client, const std::string& request);
+		static bool Process(State& state, const std::string& request, std::string& response, std::string& error);
+		static std::string GetCacheKey(const std::string& request);
+
+		static bool ReadLine(int socket, std::string& line);
+		static bool WriteAll(int socket, const std::string& data);
+
+	};
+}
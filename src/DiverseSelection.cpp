@@ -0,0 +1,105 @@
+#include "DiverseSelection.h"
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+namespace CWTeams
+{
+
+	static int PopCount(std::uint64_t value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_popcountll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		return static_cast<int>(__popcnt64(value));
+#else
+		int count = 0;
+		for (; value; value &= value - 1) count++;
+		return count;
+#endif
+	}
+
+	void DiverseSelection::SetPairBits(const GenData& data, const TeamResult& result, std::uint64_t* bits)
+	{
+		const std::size_t playerCount = data.Players.size();
+		int offset = 0;
+		for (auto size : data.Sizes)
+		{
+			for (int a = 0; a < size; a++)
+			{
+				for (int b = a + 1; b < size; b++)
+				{
+					std::size_t i = result.Teams[offset + a], j = result.Teams[offset + b];
+					if (i > j) std::swap(i, j);
+					//Pairs (i, j) with i < j numbered row by row
+					std::size_t pair = i * playerCount - i * (i + 1) / 2 + (j - i - 1);
+					bits[pair / 64] |= std::uint64_t(1) << (pair % 64);
+				}
+			}
+			offset += size;
+		}
+	}
+
+	int DiverseSelection::GetDistance(const std::uint64_t* a, const std::uint64_t* b, std::size_t words)
+	{
+		int distance = 0;
+		for (std::size_t i = 0; i < words; i++)
+		{
+			distance += PopCount(a[i] ^ b[i]);
+		}
+		return distance;
+	}
+
+	void DiverseSelection::Select(const GenData& data, std::vector<TeamResult>& results, int count)
+	{
+		if (count <= 0 || results.size() <= static_cast<std::size_t>(count)) return;
+
+		auto start = std::chrono::steady_clock::now();
+		const std::size_t playerCount = data.Players.size();
+		const std::size_t words = (playerCount * (playerCount - 1) / 2 + 63) / 64;
+		std::vector<std::uint64_t> bits(results.size() * words, 0);
+		std::vector<double> scores(results.size());
+		std::size_t first = 0;
+		for (std::size_t i = 0; i < results.size(); i++)
+		{
+			SetPairBits(data, results[i], &bits[i * words]);
+			scores[i] = GenerateTeams::GetScore(data, results[i]);
+			if (scores[i] < scores[first]) first = i;
+		}
+
+		//How far each team set is from its closest pick. Every pick only has to be compared against the newest one
+		//to keep this up to date, instead of against everything picked before. -1 marks the picks themselves
+		std::vector<int> closest(results.size(), std::numeric_limits<int>::max());
+		std::vector<std::size_t> picks { first };
+		int spread = 0;
+		while (true)
+		{
+			const std::size_t pick = picks.back();
+			const std::uint64_t* pickBits = &bits[pick * words];
+			closest[pick] = -1;
+			if (picks.size() == static_cast<std::size_t>(count)) break;
+
+			std::size_t next = pick;
+			for (std::size_t i = 0; i < results.size(); i++)
+			{
+				if (closest[i] < 0) continue;
+				int distance = GetDistance(&bits[i * words], pickBits, words);
+				if (distance < closest[i]) closest[i] = distance;
+				if (next == pick || closest[i] > closest[next] || (closest[i] == closest[next] && scores[i] < scores[next])) next = i;
+			}
+			spread = closest[next];
+			picks.push_back(next);
+		}
+
+		std::vector<TeamResult> selected;
+		selected.reserve(picks.size());
+		for (std::size_t pick : picks)
+		{
+			selected.push_back(std::move(results[pick]));
+		}
+		CW_INFO("Picked {} of {} team sets that are at least {} teammate pairs apart in {} ms", selected.size(), results.size(), spread,
+			std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+		results = std::move(selected);
+	}
+}
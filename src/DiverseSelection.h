@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "GenerateTeams.h"
+
+namespace CWTeams
+{
+
+	//Picks team sets that are balanced and also as different from each other as possible, so the top of the output isn't
+	//a list of near copies that only differ by one swap. Two team sets are as far apart as the number of pairs of players
+	//who are teammates in one of them but not the other
+	class DiverseSelection
+	{
+	public:
+		//Keeps count of results. The best scoring team set is picked first, then each pick is the one farthest from
+		//all the picks so far, ties going to the better score
+		static void Select(const GenData& data, std::vector<TeamResult>& results, int count);
+
+	private:
+		//Sets one bit for every pair of teammates in result
+		static void SetPairBits(const GenData& data, const TeamResult& result, std::uint64_t* bits);
+		static int GetDistance(const std::uint64_t* a, const std::uint64_t* b, std::size_t words);
+
+	};
+}
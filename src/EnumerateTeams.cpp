@@ -0,0 +1,344 @@
+#include "EnumerateTeams.h"
+
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <chrono>
+#include <cmath>
+
+namespace CWTeams
+{
+
+	//Subtrees with fewer players left than this are searched by whoever owns them instead of being handed out
+	static const int MIN_SPLIT_REMAINING = 6;
+	//How many nodes a worker visits between updates of the shared progress counter. Must be a power of 2
+	static const long PROGRESS_BATCH = 4096;
+	//How many times an idle worker yields before it parks, and how long it sleeps before looking for work again unless woken
+	static const int IDLE_SPINS = 64;
+	static const std::chrono::milliseconds PARK_TIMEOUT { 1 };
+
+	struct EnumerateTeams::Search
+	{
+		GenParameters& Params;
+		std::vector<std::unique_ptr<Worker>> Workers;
+
+		//Players in the order they are placed. Strongest first so that partial teams leave the allowed range as early as possible
+		std::vector<int> Order, Position;
+		//Ratings in search order, and the smallest and largest of them from each position onwards
+		std::vector<double> Ratings, MinAfter, MaxAfter;
+
+		TeamSizes Sizes;
+		std::vector<int> GroupStart, TeamOffsets;
+		//GenData::Repeats, or null without a history
+		const std::uint16_t* Repeats = nullptr;
+		long MaxRepeats = -1;
+		double MinSum, MaxSum;
+		int PlayerCount, TeamCount;
+
+		//Tasks that were pushed but haven't finished yet. The search is over once this reaches zero
+		std::atomic<long> Pending { 0 };
+		std::atomic<int> Idle { 0 };
+		std::atomic<int> Found { 0 };
+		std::atomic<bool> Stop { false };
+		std::mutex OutputLock;
+		//Idle workers park here. Woken when children are shared or the last task finishes
+		std::mutex ParkLock;
+		std::condition_variable WorkReady;
+
+		Search(GenParameters& params) : Params(params) {}
+	};
+
+	GenSummary EnumerateTeams::Gen(GenParameters& params)
+	{
+		if (params.Profile) params.Profile->Begin("setup");
+		GenData data { params.Players, params.Restrictions, params.Output };
+		GenerateTeams::Setup(params, data);
+
+		auto start = std::chrono::steady_clock::now();
+
+		Search search(params);
+		search.PlayerCount = static_cast<int>(data.Players.size());
+		search.TeamCount = static_cast<int>(data.Sizes.size());
+		search.Sizes = data.Sizes;
+
+		//In fixed point mode the ratings are whole numbers, so the partial sums and bounds are exact
+		const bool fixed = data.UseFixedPoint;
+		std::vector<double> ratings(search.PlayerCount);
+		for (int i = 0; i < search.PlayerCount; i++)
+		{
+			ratings[i] = fixed ? static_cast<double>(data.FixedRatings[i]) : data.Ratings[i];
+		}
+		if (fixed)
+		{
+			search.MinSum = static_cast<double>(data.MinFixedTeamStrength);
+			search.MaxSum = static_cast<double>(data.MaxFixedTeamStrength);
+		}
+		else
+		{
+			//Partial sums are added in a different order than AreTeamsValid uses, so leave a little slack and let it decide at the leaves
+			const double epsilon = 1e-9 * std::max(1.0, std::abs(data.NeededTeamAverage));
+			search.MinSum = data.NeededTeamAverage - data.MaxTeamDev - epsilon;
+			search.MaxSum = data.NeededTeamAverage + data.MaxTeamDev + epsilon;
+		}
+
+		search.Order.resize(search.PlayerCount);
+		std::iota(search.Order.begin(), search.Order.end(), 0);
+		std::stable_sort(search.Order.begin(), search.Order.end(), [&ratings](int a, int b) { return ratings[a] > ratings[b]; });
+		search.Position.resize(search.PlayerCount);
+		for (int i = 0; i < search.PlayerCount; i++)
+		{
+			search.Position[search.Order[i]] = i;
+		}
+
+		search.Ratings.resize(search.PlayerCount);
+		search.MinAfter.assign(search.PlayerCount + 1, 0.0);
+		search.MaxAfter.assign(search.PlayerCount + 1, 0.0);
+		for (int i = search.PlayerCount - 1; i >= 0; i--)
+		{
+			double rating = ratings[search.Order[i]];
+			bool last = i == search.PlayerCount - 1;
+			search.Ratings[i] = rating;
+			search.MinAfter[i] = last ? rating : std::min(rating, search.MinAfter[i + 1]);
+			search.MaxAfter[i] = last ? rating : std::max(rating, search.MaxAfter[i + 1]);
+		}
+
+		//Teams of the same size are interchangeable. A player may only start the first empty team of each size so every team set is visited once
+		search.GroupStart.resize(search.TeamCount);
+		search.TeamOffsets.resize(search.TeamCount);
+		for (int t = 0; t < search.TeamCount; t++)
+		{
+			search.GroupStart[t] = (t > 0 && search.Sizes[t - 1] == search.Sizes[t]) ? search.GroupStart[t - 1] : t;
+			search.TeamOffsets[t] = t == 0 ? 0 : search.TeamOffsets[t - 1] + search.Sizes[t - 1];
+		}
+
+		if (!data.Repeats.empty())
+		{
+			search.Repeats = data.Repeats.data();
+			search.MaxRepeats = data.MaxRepeats;
+		}
+
+		int threadCount = std::max(1, params.Threads);
+		for (int i = 0; i < threadCount; i++)
+		{
+			search.Workers.emplace_back(new Worker(data));
+		}
+
+		SearchNode root { 0, std::vector<std::uint8_t>(search.PlayerCount, 0), std::vector<std::uint8_t>(search.TeamCount, 0), std::vector<double>(search.TeamCount, 0.0),
+			std::vector<std::uint8_t>(search.Repeats ? search.PlayerCount : 0, 0), 0 };
+		search.Pending = 1;
+		search.Workers[0]->Queue.Push(std::move(root));
+		if (params.Profile) params.Profile->Begin("search");
+
+		CW_INFO("Enumerating every team set using {} threads", threadCount);
+		std::vector<std::thread> threads;
+		for (int i = 1; i < threadCount; i++)
+		{
+			threads.emplace_back(RunWorker, std::ref(search), i);
+		}
+		RunWorker(search, 0);
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		double seconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000000.0;
+
+		//Canonical enumeration never produces the same team set twice, so the workers' results can simply be concatenated
+		long nodes = 0;
+		for (int i = 0; i < threadCount; i++)
+		{
+			Worker& worker = *search.Workers[i];
+			data.Results.insert(data.Results.end(), worker.Results.begin(), worker.Results.end());
+			data.TeamValueFailedCount += worker.Data.TeamValueFailedCount;
+			data.PlayerRestrictionsFailedCount += worker.Data.PlayerRestrictionsFailedCount;
+			data.HistoryFailedCount += worker.Data.HistoryFailedCount;
+			nodes += worker.Nodes;
+			CW_INFO("Worker #{} ran {} tasks ({} stolen) and visited {} nodes. Busy {:.1f}% of the time", i, worker.Tasks, worker.Steals, worker.Nodes,
+				seconds > 0.0 ? 100.0 * worker.BusySeconds / seconds : 100.0);
+		}
+
+		int found = std::min(search.Found.load(), params.LimitOutput);
+		if (params.Profile) params.Profile->Begin("output");
+		GenSummary summary = GenerateTeams::Summarize(data, found, !search.Stop, !search.Stop);
+		if (params.PrintTeams) GenerateTeams::PrintResults(data);
+		if (params.Profile)
+		{
+			params.Profile->End();
+			params.Profile->SetWork(nodes, "search node");
+		}
+		if (params.Progress && params.Progress->ShouldStop())
+		{
+			CW_WARN("Interrupted after {} search nodes. Keeping the {} valid team sets found so far ({} seconds)", nodes, found, seconds);
+		}
+		else if (search.Stop)
+		{
+			CW_SUCCESS("Stopped after {} valid team sets because of the output limit ({} seconds)", found, seconds);
+		}
+		else
+		{
+			CW_SUCCESS("Found all {} valid team sets in {} seconds", found, seconds);
+		}
+		CW_SUCCESS("Visited {} search nodes. {} complete team sets failed the strength check and {} failed the restriction requirements",
+			nodes, data.TeamValueFailedCount, data.PlayerRestrictionsFailedCount);
+		return summary;
+	}
+
+	void EnumerateTeams::RunWorker(Search& search, int index)
+	{
+		Worker& worker = *search.Workers[index];
+		const int workerCount = static_cast<int>(search.Workers.size());
+		bool idle = false;
+		int spins = 0;
+		SearchNode node;
+		while (true)
+		{
+			bool found = worker.Queue.Pop(node);
+			for (int i = 1; i < workerCount && !found; i++)
+			{
+				found = search.Workers[(index + i) % workerCount]->Queue.Steal(node);
+				if (found) worker.Steals++;
+			}
+
+			if (found)
+			{
+				if (idle)
+				{
+					search.Idle--;
+					idle = false;
+				}
+				spins = 0;
+				auto taskStart = std::chrono::steady_clock::now();
+				worker.Tasks++;
+				Visit(search, worker, node);
+				worker.BusySeconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - taskStart).count() / 1000000.0;
+				if (--search.Pending == 0) search.WorkReady.notify_all();
+				continue;
+			}
+
+			if (search.Pending == 0) break;
+			if (!idle)
+			{
+				search.Idle++;
+				idle = true;
+			}
+			if (++spins < IDLE_SPINS)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+			//Shared work or the end of the search wakes us. The timeout covers a wake up that came between the steal attempts and the wait
+			std::unique_lock<std::mutex> lock(search.ParkLock);
+			search.WorkReady.wait_for(lock, PARK_TIMEOUT);
+		}
+		if (idle) search.Idle--;
+	}
+
+	void EnumerateTeams::Visit(Search& search, Worker& worker, SearchNode& node)
+	{
+		worker.Nodes++;
+		//Report in batches so the workers don't fight over the shared counter
+		if ((worker.Nodes & (PROGRESS_BATCH - 1)) == 0 && worker.Data.Progress)
+		{
+			worker.Data.Progress->Candidates.fetch_add(PROGRESS_BATCH, std::memory_order_relaxed);
+			if (worker.Data.Progress->ShouldStop()) search.Stop = true;
+		}
+		if (search.Stop.load(std::memory_order_relaxed)) return;
+
+		const int depth = node.Depth;
+		if (depth == search.PlayerCount)
+		{
+			Emit(search, worker, node);
+			return;
+		}
+
+		//When another worker is waiting, hand out this node's children instead of searching them ourselves.
+		//We pop one of them straight back off our own deque, the rest can be stolen
+		const bool share = search.Idle.load(std::memory_order_relaxed) > 0 && search.PlayerCount - depth > MIN_SPLIT_REMAINING;
+
+		const double rating = search.Ratings[depth];
+		for (int t = 0; t < search.TeamCount; t++)
+		{
+			int count = node.Counts[t];
+			if (count == search.Sizes[t]) continue;
+			if (count == 0 && t != search.GroupStart[t] && node.Counts[t - 1] == 0) continue;
+
+			const double previous = node.Sums[t];
+			const double sum = previous + rating;
+			const int open = search.Sizes[t] - count - 1;
+			if (open == 0)
+			{
+				if (sum < search.MinSum || sum > search.MaxSum) continue;
+			}
+			else
+			{
+				//Even the weakest or strongest remaining players can't bring this team back into range
+				if (sum + open * search.MinAfter[depth + 1] > search.MaxSum) continue;
+				if (sum + open * search.MaxAfter[depth + 1] < search.MinSum) continue;
+			}
+
+			//Adding a player only adds their repeats with the teammates already placed, O(team size)
+			long repeats = 0;
+			if (search.Repeats)
+			{
+				const int player = search.Order[depth];
+				const std::uint16_t* row = search.Repeats + player * search.PlayerCount;
+				const std::uint8_t* members = &node.Members[search.TeamOffsets[t]];
+				for (int i = 0; i < count; i++) repeats += row[members[i]];
+				//Repeats never go down as players are added, so a partial set that already has too many can be dropped
+				if (search.MaxRepeats >= 0 && node.Repeats + repeats > search.MaxRepeats) continue;
+				node.Members[search.TeamOffsets[t] + count] = static_cast<std::uint8_t>(player);
+			}
+
+			node.TeamOf[depth] = static_cast<std::uint8_t>(t);
+			node.Counts[t]++;
+			node.Sums[t] = sum;
+			node.Repeats += repeats;
+			node.Depth++;
+			if (share)
+			{
+				SearchNode child = node;
+				search.Pending++;
+				worker.Queue.Push(std::move(child));
+			}
+			else
+			{
+				Visit(search, worker, node);
+			}
+			node.Depth--;
+			node.Counts[t]--;
+			node.Sums[t] = previous;
+			node.Repeats -= repeats;
+		}
+		if (share) search.WorkReady.notify_all();
+	}
+
+	void EnumerateTeams::Emit(Search& search, Worker& worker, const SearchNode& node)
+	{
+		GenData& data = worker.Data;
+		//Fill each team in player order, the same order the other engines use, so double rounding in AreTeamsValid agrees with them
+		std::vector<int>& filled = worker.Filled;
+		filled.assign(search.TeamOffsets.begin(), search.TeamOffsets.end());
+		for (int player = 0; player < search.PlayerCount; player++)
+		{
+			data.Teams[filled[node.TeamOf[search.Position[player]]]++] = static_cast<std::uint8_t>(player);
+		}
+		//The repeats were added up as the players were placed
+		if (search.Repeats) data.KnownRepeats = node.Repeats;
+		if (!GenerateTeams::AreTeamsValid(data)) return;
+
+		int ordinal = ++search.Found;
+		if (ordinal > search.Params.LimitOutput) return;
+		if (ordinal == search.Params.LimitOutput) search.Stop = true;
+
+		if (search.Params.Sort)
+		{
+			GenerateTeams::Keep(data, worker.Results);
+		}
+		else
+		{
+			std::lock_guard<std::mutex> guard(search.OutputLock);
+			GenerateTeams::Print(data, ordinal);
+		}
+	}
+
+}
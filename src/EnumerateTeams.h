@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <cstdint>
+
+#include "GenerateTeams.h"
+#include "WorkStealingQueue.h"
+
+namespace CWTeams
+{
+
+	//Exhaustively lists every valid team set by placing players one at a time, pruning partial teams that can no longer end up in range.
+	//Subtrees vary wildly in size after pruning, so workers split them off on demand and steal from each other until the whole tree is done
+	class EnumerateTeams
+	{
+	public:
+		static GenSummary Gen(GenParameters& params);
+
+	private:
+		//A partial team set. The first Depth players in search order have been placed
+		struct SearchNode
+		{
+			int Depth;
+			std::vector<std::uint8_t> TeamOf;
+			std::vector<std::uint8_t> Counts;
+			std::vector<double> Sums;
+			//Who is on each team so far, laid out like GenData::Teams, and how many past teammates they repeat. Only kept with a history
+			std::vector<std::uint8_t> Members;
+			long Repeats;
+		};
+
+		struct Search;
+
+		struct Worker
+		{
+			GenData Data;
+			WorkStealingQueue<SearchNode> Queue;
+			std::vector<TeamResult> Results;
+			//Where the next player of each team goes when a leaf is turned into a team set, reused so leaves don't allocate
+			std::vector<int> Filled;
+			long Nodes = 0, Tasks = 0, Steals = 0;
+			double BusySeconds = 0.0;
+
+			Worker(const GenData& data) : Data(data) {}
+		};
+
+		static void RunWorker(Search& search, int index);
+		static void Visit(Search& search, Worker& worker, SearchNode& node);
+		static void Emit(Search& search, Worker& worker, const SearchNode& node);
+
+	};
+}
@@ -2,6 +2,8 @@
 
 #include "ExcelUtils.h"
 
+#include <stdexcept>
+
 namespace CWTeams
 {
 	namespace ExcelUtils
@@ -18,7 +20,7 @@ namespace CWTeams
 					return cell;
 				}
 			}
-			CW_FATAL("Failed to find cell [row: {}, col: {}] in sheet ", row, col.index, sheet.title());
+			throw std::runtime_error("Failed to find cell [row: " + std::to_string(row) + ", col: " + std::to_string(col.index) + "] in sheet " + sheet.title());
 
 			/*if (sheet.has_cell(xlnt::cell_reference(colIndex, rowIndex)))
 			{
@@ -34,9 +36,8 @@ namespace CWTeams
 			xlnt::cell cell = GetCell(sheet, row, col);
 			if (cell.data_type() != xlnt::cell_type::inline_string && cell.data_type() != xlnt::cell_type::shared_string)
 			{
-				CW_ERROR("Failed to find string at row {} in col {} in sheet {}", row, col.index, sheet.title());
-				CW_ERROR("Expected string but got type ", static_cast<int>(cell.data_type()));
-				exit(1);
+				throw std::runtime_error("Expected a string at row " + std::to_string(row) + " in col " + std::to_string(col.index) + " in sheet " + sheet.title()
+					+ " but got type " + std::to_string(static_cast<int>(cell.data_type())));
 			}
 
 			return cell.value<std::string>();
@@ -47,9 +48,8 @@ namespace CWTeams
 			xlnt::cell cell = GetCell(sheet, row, col);
 			if (cell.data_type() != xlnt::cell_type::number)
 			{
-				CW_ERROR("Failed to find string at row {} in col {} in sheet {}", row, col.index, sheet.title());
-				CW_ERROR("Expected string but got type ", static_cast<int>(cell.data_type()));
-				exit(1);
+				throw std::runtime_error("Expected a number at row " + std::to_string(row) + " in col " + std::to_string(col.index) + " in sheet " + sheet.title()
+					+ " but got type " + std::to_string(static_cast<int>(cell.data_type())));
 			}
 
 			return cell.value<double>();
@@ -77,8 +77,7 @@ namespace CWTeams
 				}
 			}
 
-			CW_FATAL("Failed to find");
-			return -1;
+			throw std::runtime_error("Failed to find a column starting with \"" + headerName + "\" in sheet " + sheet.title());
 		}
 	}
 };
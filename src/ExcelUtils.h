@@ -6,6 +6,7 @@
 
 namespace CWTeams
 {
+	//Every lookup throws std::runtime_error when the sheet doesn't have what was asked for
 	namespace ExcelUtils
 	{
 
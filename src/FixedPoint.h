@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+
+namespace CWTeams
+{
+
+	//A rating scaled by 10^precision and rounded to the nearest integer.
+	//Sums and comparisons of fixed ratings are exact and independent of the order players are added in
+	using FixedRating = std::int64_t;
+
+	namespace FixedPoint
+	{
+
+		inline std::int64_t GetScale(int precision)
+		{
+			std::int64_t scale = 1;
+			for (int i = 0; i < precision; i++) scale *= 10;
+			return scale;
+		}
+
+		inline FixedRating FromDouble(double value, std::int64_t scale)
+		{
+			return std::llround(value * static_cast<double>(scale));
+		}
+
+		inline double ToDouble(FixedRating value, std::int64_t scale)
+		{
+			return static_cast<double>(value) / static_cast<double>(scale);
+		}
+
+		//Integer division rounding towards negative and positive infinity respectively
+		inline std::int64_t FloorDiv(std::int64_t a, std::int64_t b)
+		{
+			std::int64_t q = a / b;
+			return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+		}
+
+		inline std::int64_t CeilDiv(std::int64_t a, std::int64_t b)
+		{
+			std::int64_t q = a / b;
+			return (a % b != 0 && ((a < 0) == (b < 0))) ? q + 1 : q;
+		}
+
+	}
+}
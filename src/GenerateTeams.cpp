@@ -1,8 +1,16 @@
 
 #include "GenerateTeams.h"
 
+#include "Random.h"
+#include "CountTeams.h"
+#include "SplitTeams.h"
+#include "EnumerateTeams.h"
+#include "ParetoArchive.h"
+#include "DiverseSelection.h"
+#include "MixedSizes.h"
+
 #include <algorithm>
-#include <random>
+#include <cmath>
 
 namespace CWTeams
 {
@@ -23,8 +31,8 @@ namespace CWTeams
 	{
 		if (TeamIndex == Data->Sizes.size())
 			CW_FATAL("Iterator out of range");
-		TeamIndex++;
 		PlayerIndex += Data->Sizes[TeamIndex];
+		TeamIndex++;
 	}
 
 	bool TeamIterator::operator!=(const TeamIterator& other)
@@ -52,156 +60,492 @@ namespace CWTeams
 	}
 	
 
-	long s_TeamValueFailedCount, s_PlayerRestrictionsFailedCount;
-	std::vector<TeamSet> s_TeamResults;
-	auto s_RNG = std::default_random_engine{};
-
-	void GenerateTeams::Gen(GenParameters& params)
+	bool GenerateTeams::IsKnownEngine(const std::string& engine)
 	{
-		s_TeamValueFailedCount = 0;
-		s_PlayerRestrictionsFailedCount = 0;
-
-		std::uint64_t TIMEOUT = params.TimeoutSeconds * 1000;
-
-		GenData data { params.Players, params.Restrictions, params.Output };
-		data.MaxTeamDev = params.MaxDev;
-		data.Sizes.resize(params.TeamCount);
-		
-		for (int i = 0; i < params.Players.size(); i++)
-		{
-			data.Sizes[i % data.Sizes.size()]++;
-		}
+		return engine == "auto" || engine == "sample" || engine == "split" || engine == "exhaustive";
+	}
 
-		data.Weights = params.WeightsMap.Select(data.Sizes);
-		
+	bool GenerateTeams::ParseAxisDeviation(const std::string& value, std::vector<double>& result)
+	{
+		result.clear();
+		std::stringstream ss(value);
+		std::string part;
+		try
 		{
-			std::stringstream ss;
-			ss << "Match is set for: ";
-			for (int i = 0; i < data.Sizes.size(); i++)
+			while (std::getline(ss, part, ','))
 			{
-				ss << (int) data.Sizes[i];
-				if ( i < data.Sizes.size() - 1)
-				{
-					ss << " v ";
-				}
+				result.push_back(std::stod(part));
 			}
-			CW_INFO(ss.str());
 		}
+		catch (std::exception& e)
+		{
+			return false;
+		}
+		if (result.size() == 1) result.resize(3, result[0]);
+		return result.size() == 3;
+	}
 
-		double average = 0.0;
-		for (const auto& player : data.Players) average += player.GetOverall(data.Weights);
-		average /= data.Players.size();
-
-		double averageTeamSize = (double) data.Players.size() / (double) data.Sizes.size();
-		data.NeededTeamAverage = average * averageTeamSize;
-		CW_INFO("Average team size is {}. average team rating is {} +-{}", averageTeamSize, data.NeededTeamAverage, data.MaxTeamDev);
+	GenSummary GenerateTeams::Run(GenParameters& params)
+	{
+		if (params.CountOnly)
+		{
+			GenSummary summary;
+			if (params.Profile) params.Profile->Begin("count");
+			summary.ValidSets = static_cast<long>(CountTeams::Count(params, summary.Complete));
+			summary.Exact = summary.Complete;
+			if (params.Profile) params.Profile->End();
+			return summary;
+		}
+		if (params.SizeSlack > 0 && params.Sizes.empty())
+		{
+			CW_INFO("Using the sample engine for every team size layout");
+			return MixedSizes::Gen(params);
+		}
 
+		std::string engine = params.Engine;
+		if (engine == "auto")
+		{
+			engine = params.TeamCount == 2 && params.Players.size() <= SplitTeams::AUTO_MAX_PLAYERS ? "split" : "sample";
+		}
+		CW_INFO("Using the {} engine", engine);
 
-		//The indices of tempPlayers correspond to the indices of players inside the players list
-		//Jumps of indices according to the values in teamSizes indicate teams
-		//IE if teamSizes = {2, 3, 2} then the first 2 indices in tempPlayers are on team #1 the next indices in tempPlayers are on team #2 etc
-		//This is done in a single 1d array to improve cache locality and thus performance
-		data.Teams.resize(data.Players.size());
-		for (int i = 0; i < data.Teams.size(); i++)
+		if (engine == "split")
 		{
-			//Fill in the most basic team mapping
-			data.Teams[i] = i;
+			return SplitTeams::Gen(params);
+		}
+		else if (engine == "exhaustive")
+		{
+			return EnumerateTeams::Gen(params);
+		}
+		else if (engine == "sample")
+		{
+			return Gen(params);
 		}
+		CW_FATAL("Unknown engine \"{}\"", engine);
+		return GenSummary();
+	}
+
+	GenSummary GenerateTeams::Gen(GenParameters& params)
+	{
+		std::uint64_t TIMEOUT = params.TimeoutSeconds * 1000;
+		Random rng = Random::Stream(params.Seed, params.Stream, params.Substream);
 
-		//This set contains hashes of the team combos that we already tried so that we don't repeat
-		std::set<std::uint64_t> combinationsTried;
+		if (params.Profile) params.Profile->Begin("setup");
+		GenData data { params.Players, params.Restrictions, params.Output };
+		Setup(params, data);
+		if (params.Profile) params.Profile->Begin("search");
+
+		//The last team is made of whoever is left over, so only the positions before it need to be shuffled
+		std::size_t shuffleCount = data.Players.size() - data.Sizes.back();
+
+		//Maps the hashes of the team combos that we already tried to how many times they came up, so that we don't repeat.
+		//The capture counts drive a capture-recapture estimate of how many valid team sets exist in total
+		std::map<std::uint64_t, std::uint32_t> combinationsTried;
+		long validDraws = 0, seenOnce = 0, seenTwice = 0;
+		//Set when the search ran out of new team sets rather than hitting the output limit
+		bool exhausted = false;
+		double estimatedTotal = 0.0;
 		auto start = std::chrono::steady_clock::now();
 		auto lastOption = std::chrono::steady_clock::now();
 
 		//Initialize counters to 0
 		long comboCount = 0;
-		s_TeamValueFailedCount = 0;
-		s_PlayerRestrictionsFailedCount = 0;
+		//What was last added to the shared progress, which is only updated every so many candidates since other searches may share it
+		long reportedCombos = 0, reportedDraws = 0;
+		auto report = [&]()
+		{
+			data.Progress->Candidates.fetch_add(comboCount - reportedCombos, std::memory_order_relaxed);
+			data.Progress->Draws.fetch_add(validDraws - reportedDraws, std::memory_order_relaxed);
+			reportedCombos = comboCount;
+			reportedDraws = validDraws;
+		};
 		CW_INFO("Searching for teams... this may take a while");
 		for (int validOptions = 0; validOptions < params.LimitOutput; )
 		{
-			std::shuffle(data.Teams.begin(), data.Teams.end(), s_RNG);
+			rng.PartialShuffle(data.Teams, shuffleCount);
 			comboCount++;
 			auto singleStart = std::chrono::steady_clock::now();
+			bool timedOut = false;
 			while (!AreTeamsValid(data))
 			{
+				if (data.Progress && comboCount - reportedCombos >= PROGRESS_INTERVAL)
+				{
+					report();
+					if (data.Progress->ShouldStop()) break;
+				}
 				if (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - singleStart).count() > TIMEOUT)
 				{
-					PrintResults(data);
-					CW_FATAL("Failed to find more team combination after {} seconds! Tried {} combinations to no avail", TIMEOUT / 1000, comboCount);
+					timedOut = true;
+					break;
 				}
-				std::shuffle(data.Teams.begin(), data.Teams.end(), s_RNG);
+				rng.PartialShuffle(data.Teams, shuffleCount);
 				comboCount++;
 			}
+			if (timedOut)
+			{
+				//Still print whatever was found so far
+				CW_ERROR("Failed to find more team combination after {} seconds! Tried {} combinations to no avail", TIMEOUT / 1000, comboCount);
+				exhausted = true;
+				break;
+			}
+			if (data.Progress)
+			{
+				if (data.Progress->ShouldStop())
+				{
+					CW_WARN("Interrupted after {} combinations. Keeping the {} team sets found so far", comboCount, combinationsTried.size());
+					break;
+				}
+			}
+			validDraws++;
+			if (data.Progress && comboCount - reportedCombos >= PROGRESS_INTERVAL) report();
 			std::uint64_t hash = GetTeamsHash(data);
-			if (combinationsTried.find(hash) == combinationsTried.end())
+			auto it = combinationsTried.find(hash);
+			if (it == combinationsTried.end())
 			{
 				//We found a valid configuration
 				lastOption = std::chrono::steady_clock::now();
 				validOptions++;
-				combinationsTried.insert(hash);
+				combinationsTried[hash] = 1;
+				seenOnce++;
 				if (params.Sort)
 				{
-					s_TeamResults.push_back(data.Teams);
+					Keep(data, data.Results);
 				}
 				else
 				{
-					PrintTeam(data, validOptions);
+					Print(data, validOptions);
 				}
 
 			}
 			else
 			{
+				std::uint32_t captures = ++it->second;
+				if (captures == 2)
+				{
+					seenOnce--;
+					seenTwice++;
+				}
+				else if (captures == 3)
+				{
+					seenTwice--;
+				}
+
+				//Every valid team set is equally likely to be drawn, so once nearly every draw is a repeat we have seen almost all of them
+				long repeats = validDraws - static_cast<long>(combinationsTried.size());
+				if (repeats >= MIN_REPEATS_BEFORE_STOPPING)
+				{
+					estimatedTotal = EstimateTotalSets(combinationsTried.size(), seenOnce, seenTwice);
+					if (combinationsTried.size() / estimatedTotal >= params.StopCoverage)
+					{
+						CW_INFO("Found {} of an estimated {:.1f} valid team sets ({:.2f}% coverage). Stopping search", combinationsTried.size(), estimatedTotal, 100.0 * combinationsTried.size() / estimatedTotal);
+						exhausted = true;
+						break;
+					}
+				}
+
 				//Check for timeout in case we already found all possible teams
 				if (std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - lastOption).count() > TIMEOUT)
 				{
 					CW_WARN("Failed to find more team combinations after {} seconds! Low search space? Exiting!", TIMEOUT / 1000);
+					exhausted = true;
 					break;
 				}
 
 			}
 		}
 
+		if (data.Progress) report();
+
 		double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
-		PrintResults(data);
+		if (params.Profile) params.Profile->Begin("output");
+		GenSummary summary = Summarize(data, static_cast<long>(combinationsTried.size()), exhausted, false);
+		if (params.PrintTeams) PrintResults(data);
+		if (params.Profile)
+		{
+			params.Profile->End();
+			params.Profile->SetWork(comboCount, "configuration");
+		}
 		CW_SUCCESS("Generated {} valid team possibilities in {} seconds", combinationsTried.size(), seconds);
 		CW_SUCCESS("Evaluated {} possible configurations", comboCount);
+		estimatedTotal = EstimateTotalSets(combinationsTried.size(), seenOnce, seenTwice);
+		CW_SUCCESS("Estimated {:.1f} valid team sets exist in total from {} valid draws ({:.2f}% found)",
+			estimatedTotal, validDraws, combinationsTried.size() == 0 ? 0.0 : 100.0 * combinationsTried.size() / estimatedTotal);
 
 		CW_SUCCESS("That's {} configurations/second ({} nano seconds / configuration) evaluated",
 			comboCount / seconds, seconds / comboCount * 1000000000.0);
 		
-		CW_SUCCESS("Of the {} attempted configurations, {} had a value out of range, and {} failed the restriction requirements",
-			comboCount, s_TeamValueFailedCount, s_PlayerRestrictionsFailedCount);
+		CW_SUCCESS("Of the {} attempted configurations, {} had a value out of range ({} after summing half a team), and {} failed the restriction requirements",
+			comboCount, data.TeamValueFailedCount, data.PartialFailedCount, data.PlayerRestrictionsFailedCount);
+		return summary;
 	}
 
-	void GenerateTeams::PrintResults(GenData& data)
+	TeamSizes GenerateTeams::GetRoundRobinSizes(int playerCount, int teamCount)
+	{
+		TeamSizes sizes(teamCount);
+		for (int i = 0; i < playerCount; i++)
+		{
+			sizes[i % sizes.size()]++;
+		}
+		return sizes;
+	}
+
+	void GenerateTeams::Setup(GenParameters& params, GenData& data)
 	{
-		std::sort(s_TeamResults.begin(), s_TeamResults.end(), [&data](TeamSet& a, TeamSet& b) {
-			data.Teams = std::move(a);
-			double aStrength = GetTeamsDeltaStrength(data);
-			a = std::move(data.Teams);
+		data.MaxTeamDev = params.MaxDev;
+		data.Sizes = params.Sizes.empty() ? GetRoundRobinSizes(static_cast<int>(params.Players.size()), params.TeamCount) : params.Sizes;
+
+		data.Weights = params.WeightsMap.Select(data.Sizes);
+		
+		{
+			std::stringstream ss;
+			ss << "Match is set for: ";
+			for (int i = 0; i < data.Sizes.size(); i++)
+			{
+				ss << (int) data.Sizes[i];
+				if ( i < data.Sizes.size() - 1)
+				{
+					ss << " v ";
+				}
+			}
+			CW_INFO(ss.str());
+		}
+
+		data.Ratings.clear();
+		for (const auto& player : data.Players) data.Ratings.push_back(player.GetOverall(data.Weights));
 
-			data.Teams = std::move(b);
-			double bStrength = GetTeamsDeltaStrength(data);
-			b = std::move(data.Teams);
-			
-			return aStrength > bStrength;
+		data.UseFixedPoint = params.FixedPoint;
+		data.FixedScale = FixedPoint::GetScale(params.Precision);
+		data.FixedRatings.clear();
+		for (double rating : data.Ratings)
+		{
+			data.FixedRatings.push_back(FixedPoint::FromDouble(rating, data.FixedScale));
+		}
+		SetupTeamRatings(params, data);
+
+		if (data.UseFixedPoint)
+		{
+			CW_INFO("Comparing ratings as integers with {} decimal places. Teams must have a strength between {} and {}", params.Precision,
+				FixedPoint::ToDouble(data.MinFixedTeamStrength, data.FixedScale), FixedPoint::ToDouble(data.MaxFixedTeamStrength, data.FixedScale));
+		}
+
+
+		//The indices of tempPlayers correspond to the indices of players inside the players list
+		//Jumps of indices according to the values in teamSizes indicate teams
+		//IE if teamSizes = {2, 3, 2} then the first 2 indices in tempPlayers are on team #1 the next indices in tempPlayers are on team #2 etc
+		//This is done in a single 1d array to improve cache locality and thus performance
+		data.TeamValueFailedCount = 0;
+		data.PlayerRestrictionsFailedCount = 0;
+		data.TeamStrengths.assign(data.Sizes.size(), 0.0);
+		SetupEarlyReject(data);
+		SetupAxes(params, data);
+
+		data.DiverseCount = params.Diverse;
+		if (data.DiverseCount > 0 && !params.Sort)
+		{
+			CW_WARN("Diverse team sets can only be picked once the search is over, so results will be sorted");
+			params.Sort = true;
+		}
+
+		data.Repeats.clear();
+		data.RepeatPenalty = 0;
+		data.MaxRepeats = params.MaxRepeats;
+		data.HistoryWeight = params.HistoryWeight;
+		data.HistoryFailedCount = 0;
+		if (params.History)
+		{
+			params.History->BuildRepeats(data.Players, data.Repeats);
+			CW_INFO("Avoiding teammates from {} past matches. Each repeat costs {} when ranking{}", params.History->GetMatchCount(), data.HistoryWeight,
+				data.MaxRepeats >= 0 ? " and at most " + std::to_string(data.MaxRepeats) + " are allowed" : "");
+		}
+		//Unsorted team sets are printed as they are found, so they reach the file right away
+		data.Writer = std::make_shared<OutputWriter>(params.Output, params.Format, !params.Sort);
+		data.OnTeamSet = params.OnTeamSet;
+		data.Progress = params.Progress;
+
+		data.Teams.resize(data.Players.size());
+		for (int i = 0; i < data.Teams.size(); i++)
+		{
+			//Fill in the most basic team mapping
+			data.Teams[i] = i;
+		}
+	}
+
+	void GenerateTeams::SetupTeamRatings(GenParameters& params, GenData& data)
+	{
+		const std::size_t playerCount = data.Players.size();
+		const std::int64_t teamCount = data.Sizes.size();
+		data.TeamRows.assign(teamCount, 0);
+		if (!params.PerTeamWeights)
+		{
+			data.SizeRatings = data.Ratings;
+			data.FixedSizeRatings = data.FixedRatings;
+		}
+		else
+		{
+			//Every size up to the largest team gets a row so that a team's row is found by its size alone
+			const int largest = *std::max_element(data.Sizes.begin(), data.Sizes.end());
+			data.SizeRatings.assign((largest + 1) * playerCount, 0.0);
+			data.FixedSizeRatings.assign((largest + 1) * playerCount, 0);
+			for (int size = 1; size <= largest; size++)
+			{
+				WeightsData weights;
+				if (!params.WeightsMap.TrySelectTeam(size, weights))
+				{
+					if (std::find(data.Sizes.begin(), data.Sizes.end(), size) != data.Sizes.end())
+					{
+						CW_FATAL("Failed to find situation \"{}v\" to weight the teams of {} players with", size, size);
+					}
+					continue;
+				}
+				for (std::size_t i = 0; i < playerCount; i++)
+				{
+					data.SizeRatings[size * playerCount + i] = data.Players[i].GetOverall(weights);
+					data.FixedSizeRatings[size * playerCount + i] = FixedPoint::FromDouble(data.SizeRatings[size * playerCount + i], data.FixedScale);
+				}
+			}
+			for (int t = 0; t < teamCount; t++)
+			{
+				data.TeamRows[t] = data.Sizes[t] * playerCount;
+			}
+			CW_INFO("Weighting each team with the weights for its own size");
+		}
+
+		//Every team is held to the average team strength, which is each team's share of the players summed with its own row.
+		//Without per team weights this is the average rating times the average team size
+		double total = 0.0;
+		FixedRating fixedTotal = 0;
+		for (int t = 0; t < teamCount; t++)
+		{
+			double rowTotal = 0.0;
+			FixedRating fixedRowTotal = 0;
+			for (std::size_t i = 0; i < playerCount; i++)
+			{
+				rowTotal += data.SizeRatings[data.TeamRows[t] + i];
+				fixedRowTotal += data.FixedSizeRatings[data.TeamRows[t] + i];
+			}
+			total += data.Sizes[t] * rowTotal;
+			fixedTotal += data.Sizes[t] * fixedRowTotal;
+		}
+		const std::int64_t divisor = static_cast<std::int64_t>(playerCount) * teamCount;
+		data.NeededTeamAverage = total / divisor;
+		CW_INFO("Average team size is {}. average team rating is {} +-{}", (double) playerCount / teamCount, data.NeededTeamAverage, data.MaxTeamDev);
+
+		//|fixedTotal / divisor - teamStrength| <= maxDev multiplied through by divisor so that the test stays exact
+		FixedRating fixedMaxDev = FixedPoint::FromDouble(data.MaxTeamDev, data.FixedScale);
+		data.MinFixedTeamStrength = FixedPoint::CeilDiv(fixedTotal - divisor * fixedMaxDev, divisor);
+		data.MaxFixedTeamStrength = FixedPoint::FloorDiv(fixedTotal + divisor * fixedMaxDev, divisor);
+	}
+
+	void GenerateTeams::SetupEarlyReject(GenData& data)
+	{
+		const std::size_t playerCount = data.Players.size();
+		data.LowestSums.assign(data.SizeRatings.size(), 0.0);
+		data.HighestSums.assign(data.SizeRatings.size(), 0.0);
+		data.FixedLowestSums.assign(data.FixedSizeRatings.size(), 0);
+		data.FixedHighestSums.assign(data.FixedSizeRatings.size(), 0);
+		for (std::size_t row = 0; row < data.SizeRatings.size(); row += playerCount)
+		{
+			std::vector<double> ratings(data.SizeRatings.begin() + row, data.SizeRatings.begin() + row + playerCount);
+			std::vector<FixedRating> fixedRatings(data.FixedSizeRatings.begin() + row, data.FixedSizeRatings.begin() + row + playerCount);
+			std::sort(ratings.begin(), ratings.end());
+			std::sort(fixedRatings.begin(), fixedRatings.end());
+			//A team is never as large as the whole row once it is split in half, so k only goes up to playerCount - 1
+			for (std::size_t k = 1; k < playerCount; k++)
+			{
+				data.LowestSums[row + k] = data.LowestSums[row + k - 1] + ratings[k - 1];
+				data.HighestSums[row + k] = data.HighestSums[row + k - 1] + ratings[playerCount - k];
+				data.FixedLowestSums[row + k] = data.FixedLowestSums[row + k - 1] + fixedRatings[k - 1];
+				data.FixedHighestSums[row + k] = data.FixedHighestSums[row + k - 1] + fixedRatings[playerCount - k];
+			}
+		}
+		const double epsilon = 1e-9 * std::max(1.0, std::abs(data.NeededTeamAverage));
+		data.MinPartialStrength = data.NeededTeamAverage - data.MaxTeamDev - epsilon;
+		data.MaxPartialStrength = data.NeededTeamAverage + data.MaxTeamDev + epsilon;
+		data.PartialFailedCount = data.LastPartialRejects = 0;
+		data.UsePartialBound = true;
+		data.PeriodsUntilProbe = PARTIAL_BOUND_PROBE_PERIODS;
+
+		const std::size_t teamCount = data.Sizes.size();
+		data.CheckOrder.resize(teamCount);
+		for (std::size_t t = 0; t < teamCount; t++) data.CheckOrder[t] = static_cast<std::uint8_t>(t);
+		data.TeamRejects.assign(teamCount, 0);
+		data.RestrictionChecks = 0;
+		data.LastStrengthRejects = data.LastRestrictionRejects = 0;
+		data.RestrictionsFirst = false;
+		data.ChecksUntilReorder = REORDER_INTERVAL;
+	}
+
+	double GenerateTeams::EstimateTotalSets(std::size_t distinct, long seenOnce, long seenTwice)
+	{
+		//Bias-corrected Chao1 estimator: the sets we saw exactly once or twice tell us how many we have not seen yet
+		return distinct + (seenOnce * (seenOnce - 1.0)) / (2.0 * (seenTwice + 1.0));
+	}
+
+	void GenerateTeams::PrintResults(GenData& data)
+	{
+		std::sort(data.Results.begin(), data.Results.end(), [&data](const TeamResult& a, const TeamResult& b) {
+			return GetScore(data, a) > GetScore(data, b);
 		});
 		int i = 0;
-		for (auto& team : s_TeamResults)
+		for (const auto& result : data.Results)
+		{
+			PrintTeam(data, result, data.Results.size() - i++);
+		}
+		data.Writer->Flush();
+	}
+
+	GenSummary GenerateTeams::Summarize(GenData& data, long validSets, bool complete, bool exact)
+	{
+		if (data.Archive)
+		{
+			data.Archive->MoveTo(data.Results);
+			CW_INFO("{} team sets are on the Pareto front", data.Results.size());
+		}
+		if (data.DiverseCount > 0)
+		{
+			DiverseSelection::Select(data, data.Results, data.DiverseCount);
+		}
+		if (!data.Repeats.empty() && data.MaxRepeats >= 0)
+		{
+			CW_INFO("{} otherwise valid team sets repeated more than {} past teammates", data.HistoryFailedCount, data.MaxRepeats);
+		}
+
+		GenSummary summary;
+		summary.ValidSets = validSets;
+		summary.Complete = complete;
+		summary.Exact = exact;
+		for (const auto& result : data.Results)
 		{
-			data.Teams = std::move(team);
-			PrintTeam(data, s_TeamResults.size() - i++);
+			if (std::isnan(summary.BestDelta) || result.Delta < summary.BestDelta)
+			{
+				summary.BestDelta = result.Delta;
+			}
 		}
+		return summary;
 	}
 
-	double GenerateTeams::GetTeamStrength(const GenData& data, const Team& team)
+	double GenerateTeams::GetTeamStrength(const GenData& data, const Team& team, int teamIndex)
 	{
+		if (data.UseFixedPoint)
+		{
+			return FixedPoint::ToDouble(GetFixedTeamStrength(data, team, teamIndex), data.FixedScale);
+		}
+		const double* ratings = &data.SizeRatings[data.TeamRows[teamIndex]];
 		double teamStrength = 0.0;
 		for (auto playerID : team)
 		{
-			const CWPlayer& player = data.Players[playerID];
-			teamStrength += player.GetOverall(data.Weights);
+			teamStrength += ratings[playerID];
+		}
+		return teamStrength;
+	}
+
+	FixedRating GenerateTeams::GetFixedTeamStrength(const GenData& data, const Team& team, int teamIndex)
+	{
+		const FixedRating* ratings = &data.FixedSizeRatings[data.TeamRows[teamIndex]];
+		FixedRating teamStrength = 0;
+		for (auto playerID : team)
+		{
+			teamStrength += ratings[playerID];
 		}
 		return teamStrength;
 	}
@@ -209,9 +553,10 @@ namespace CWTeams
 	double GenerateTeams::GetTeamsDeltaStrength(const GenData& data)
 	{
 		double minStrength = 0.0, maxStrength = 0.0;
+		int teamIndex = 0;
 		for (const auto& team : data)
 		{
-			double teamStrength = GetTeamStrength(data, team);
+			double teamStrength = GetTeamStrength(data, team, teamIndex++);
 
 			if (minStrength == 0.0 || teamStrength < minStrength)
 			{
@@ -226,85 +571,377 @@ namespace CWTeams
 	}
 
 
-	void GenerateTeams::PrintTeam(const GenData& data, int ordal)
+	TeamResult GenerateTeams::MakeResult(const GenData& data)
 	{
-		fprintf(data.Output, "\nTEAM-SET #%d - delta: %f\n", ordal, GetTeamsDeltaStrength(data));
-		int playerIndex = 0;
-		int teamIndex = 0;
-		for (const auto& team : data)
-		{
-			fprintf(data.Output, "\tTeam #%d strength %f\n", teamIndex, GetTeamStrength(data, team));
+		TeamResult result { data.Teams, data.TeamStrengths, 0.0, data.RepeatPenalty };
+		auto range = std::minmax_element(result.Strengths.begin(), result.Strengths.end());
+		result.Delta = *range.second - *range.first;
+		return result;
+	}
 
-			//Go in reverse to print the best players first
-			for (auto playerID : team)
-			{
-				CWPlayer& player = data.Players[playerID];
-				fprintf(data.Output, "\t\t%s (%s)\n", player.RealName.c_str(), player.Username.c_str());
-			}
-			teamIndex++;
+	void GenerateTeams::PrintTeam(const GenData& data, const TeamResult& result, int ordal)
+	{
+		if (data.OnTeamSet)
+		{
+			data.OnTeamSet(data, result, ordal);
+			return;
 		}
+		data.Writer->Write(data, result, ordal);
+	}
+
+	static std::uint64_t MixHash(std::uint64_t x)
+	{
+		//splitmix64 finalizer
+		x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+		return x ^ (x >> 31);
 	}
 
 	std::uint64_t GenerateTeams::GetTeamsHash(const GenData& data)
 	{
-		//Sort the hashes by value so that teams with players in a different order are still considered the same team
+		//Summing well mixed player hashes doesn't depend on the order of players inside a team.
+		//Small polynomial hashes of the raw ids collided often enough to throw away valid team sets
 		std::vector<std::uint64_t> teamHashes(data.Sizes.size());
 		int teamIndex = 0;
 		for (const auto& team : data)
 		{
-			std::vector<std::size_t> individualHashes(team.TeamSize);
-			{
-				int i = 0;
-				for (auto playerID : team)
-				{
-					individualHashes[i++] = playerID;
-				}
-			}
-			std::sort(individualHashes.begin(), individualHashes.end());
-			std::uint64_t hash = 1;
-			for (int i = 0; i < individualHashes.size(); i++)
+			std::uint64_t hash = 0;
+			for (auto playerID : team)
 			{
-				hash = 61 * hash + individualHashes[i];
+				hash += MixHash(playerID + 1);
 			}
 			teamHashes[teamIndex++] = hash;
 		}
+		//Sort the hashes by value so that the same teams in a different order are still considered the same team set
 		std::sort(teamHashes.begin(), teamHashes.end());
 
 		std::uint64_t result = 1;
 		for (std::uint64_t val : teamHashes)
 		{
-			result = 31 * result + val;
+			result = MixHash(result ^ val);
 		}
 
 		return result;
 
 	}
 
-	bool GenerateTeams::AreTeamsValid(const GenData& data)
+	void GenerateTeams::Keep(GenData& data, std::vector<TeamResult>& results)
+	{
+		if (data.Archive)
+		{
+			data.Archive->Insert(data.AxisSpread, data);
+			if (data.Progress)
+			{
+				auto range = std::minmax_element(data.TeamStrengths.begin(), data.TeamStrengths.end());
+				data.Progress->Found(*range.second - *range.first);
+			}
+			return;
+		}
+		results.push_back(MakeResult(data));
+		if (data.Progress) data.Progress->Found(results.back().Delta);
+	}
+
+	void GenerateTeams::Print(GenData& data, int ordinal)
+	{
+		TeamResult result = MakeResult(data);
+		if (data.Progress) data.Progress->Found(result.Delta);
+		PrintTeam(data, result, ordinal);
+	}
+
+	void GenerateTeams::SetupAxes(GenParameters& params, GenData& data)
+	{
+		data.UseAxes = !params.AxisDeviation.empty() || params.Pareto;
+		data.Archive.reset();
+		if (!data.UseAxes) return;
+
+		if (!data.UseFixedPoint)
+		{
+			CW_INFO("Balancing each axis compares ratings as integers with {} decimal places", params.Precision);
+			data.UseFixedPoint = true;
+		}
+
+		if (!DoAxesFit(data.Players, data.Weights, params.Precision))
+		{
+			CW_FATAL("Ratings are too large to balance each axis with {} decimal places. Use a lower --precision", params.Precision);
+		}
+
+		std::int64_t totals[AXIS_COUNT] = {};
+		data.AxisRatings.clear();
+		for (int i = 0; i < data.Players.size(); i++)
+		{
+			const CWPlayer& player = data.Players[i];
+			const std::int64_t lanes[AXIS_COUNT] = { data.FixedRatings[i], FixedPoint::FromDouble(player.PVP, data.FixedScale),
+				FixedPoint::FromDouble(player.Gamesense, data.FixedScale), FixedPoint::FromDouble(player.Teamwork, data.FixedScale) };
+			AxisVector ratings;
+			for (int axis = 0; axis < AXIS_COUNT; axis++)
+			{
+				ratings.Lanes[axis] = static_cast<std::int32_t>(lanes[axis]);
+				totals[axis] += lanes[axis];
+			}
+			data.AxisRatings.push_back(ratings);
+		}
+		const std::int64_t laneMax = std::numeric_limits<std::int32_t>::max();
+
+		auto clamp = [laneMax](std::int64_t value) { return static_cast<std::int32_t>(std::max(-laneMax, std::min(laneMax, value))); };
+		const std::int64_t teamCount = data.Sizes.size();
+		data.MinAxisStrength.Lanes[0] = clamp(data.MinFixedTeamStrength);
+		data.MaxAxisStrength.Lanes[0] = clamp(data.MaxFixedTeamStrength);
+		for (int axis = 1; axis < AXIS_COUNT; axis++)
+		{
+			if (params.AxisDeviation.empty())
+			{
+				data.MinAxisStrength.Lanes[axis] = clamp(-laneMax);
+				data.MaxAxisStrength.Lanes[axis] = clamp(laneMax);
+				continue;
+			}
+			FixedRating deviation = FixedPoint::FromDouble(params.AxisDeviation[axis - 1], data.FixedScale);
+			data.MinAxisStrength.Lanes[axis] = clamp(FixedPoint::CeilDiv(totals[axis] - teamCount * deviation, teamCount));
+			data.MaxAxisStrength.Lanes[axis] = clamp(FixedPoint::FloorDiv(totals[axis] + teamCount * deviation, teamCount));
+		}
+		data.AxisSpread = Axes::Fill(0);
+		if (!params.AxisDeviation.empty())
+		{
+			CW_INFO("Team PVP, gamesense and teamwork must be within +-{}, +-{} and +-{} of their averages",
+				params.AxisDeviation[0], params.AxisDeviation[1], params.AxisDeviation[2]);
+		}
+
+		if (params.Pareto)
+		{
+			if (!params.Sort)
+			{
+				CW_WARN("The Pareto front is only known once the search is over, so results will be sorted");
+				params.Sort = true;
+			}
+			data.Archive = std::make_shared<ParetoArchive>();
+		}
+	}
+
+	bool GenerateTeams::DoAxesFit(const std::vector<CWPlayer>& players, const WeightsData& weights, int precision)
+	{
+		const std::int64_t scale = FixedPoint::GetScale(precision);
+		std::int64_t largest = 0;
+		for (const CWPlayer& player : players)
+		{
+			for (double rating : { player.GetOverall(weights), player.PVP, player.Gamesense, player.Teamwork })
+			{
+				largest = std::max(largest, std::abs(FixedPoint::FromDouble(rating, scale)));
+			}
+		}
+		//Every sum is done in 32 bit lanes
+		return largest * static_cast<std::int64_t>(players.size()) <= std::numeric_limits<std::int32_t>::max();
+	}
+
+	//AreTeamsValid for when every axis is balanced. All four sums of a team are added and range checked together
+	bool GenerateTeams::AreAxesValid(GenData& data)
 	{
+		AxisVector low = Axes::Fill(0), high = Axes::Fill(0);
+		int teamIndex = 0;
 		for (const auto& team : data)
 		{
-			double teamStrength = GetTeamStrength(data, team);
-			//Make sure this team is within range of the max deviation
-			if (std::abs(data.NeededTeamAverage - teamStrength) > data.MaxTeamDev)
+			AxisVector strength = Axes::Sum(data.AxisRatings, team);
+			if (!Axes::InRange(strength, data.MinAxisStrength, data.MaxAxisStrength))
 			{
-				//This team is too good or too bad...
-				s_TeamValueFailedCount++;
+				data.TeamValueFailedCount++;
 				return false;
 			}
 			for (const auto& restriction : data.Restrictions)
 			{
 				if (!restriction->IsValidTeam(data.Players, team))
 				{
-					s_PlayerRestrictionsFailedCount++;
+					data.PlayerRestrictionsFailedCount++;
 					return false;
 				}
 			}
+			data.TeamStrengths[teamIndex] = FixedPoint::ToDouble(strength.Lanes[0], data.FixedScale);
+			if (teamIndex == 0)
+			{
+				low = strength;
+				high = strength;
+			}
+			else
+			{
+				Axes::Widen(low, high, strength);
+			}
+			teamIndex++;
+		}
+		data.AxisSpread = Axes::Subtract(high, low);
+		return true;
+	}
+
+	bool GenerateTeams::AreTeamsValid(GenData& data)
+	{
+		if (data.UseAxes) return AreAxesValid(data) && AreRepeatsValid(data);
+		if (--data.ChecksUntilReorder == 0) ReorderChecks(data);
+
+		for (int teamIndex : data.CheckOrder)
+		{
+			//Rebalancing changes the sizes between calls, so where each team starts is worked out every time.
+			//Most candidates are rejected by the first team checked, which only costs this loop for teams late in the order
+			int offset = 0;
+			for (int t = 0; t < teamIndex; t++) offset += data.Sizes[t];
+			Team team { data.Teams, offset, data.Sizes[teamIndex] };
+			//Whichever check rejected more of the teams it saw lately goes first
+			bool valid = data.RestrictionsFirst ? AreRestrictionsValid(data, team) && IsTeamInRange(data, team, teamIndex)
+				: IsTeamInRange(data, team, teamIndex) && AreRestrictionsValid(data, team);
+			if (!valid)
+			{
+				data.TeamRejects[teamIndex]++;
+				return false;
+			}
 		}
 
+		return AreRepeatsValid(data);
+	}
+
+	bool GenerateTeams::IsTeamInRange(GenData& data, const Team& team, int teamIndex)
+	{
+		//Make sure this team is within range of the max deviation. The players not summed yet are at least as strong as the weakest ones
+		//in the row and at most as strong as the strongest, so a team that is already too far off after half of it can stop there
+		const std::size_t row = data.TeamRows[teamIndex];
+		const int half = data.UsePartialBound ? team.TeamSize / 2 : 0, rest = team.TeamSize - half;
+		auto player = team.begin();
+		bool outOfRange;
+		if (data.UseFixedPoint)
+		{
+			const FixedRating* ratings = &data.FixedSizeRatings[row];
+			FixedRating teamStrength = 0;
+			for (int i = 0; i < half; i++) teamStrength += ratings[*player++];
+			outOfRange = half > 0 && (teamStrength + data.FixedLowestSums[row + rest] > data.MaxFixedTeamStrength
+				|| teamStrength + data.FixedHighestSums[row + rest] < data.MinFixedTeamStrength);
+			if (outOfRange)
+			{
+				data.PartialFailedCount++;
+			}
+			else
+			{
+				for (; player != team.end(); ++player) teamStrength += ratings[*player];
+				outOfRange = teamStrength < data.MinFixedTeamStrength || teamStrength > data.MaxFixedTeamStrength;
+				data.TeamStrengths[teamIndex] = FixedPoint::ToDouble(teamStrength, data.FixedScale);
+			}
+		}
+		else
+		{
+			const double* ratings = &data.SizeRatings[row];
+			double teamStrength = 0.0;
+			for (int i = 0; i < half; i++) teamStrength += ratings[*player++];
+			outOfRange = half > 0 && (teamStrength + data.LowestSums[row + rest] > data.MaxPartialStrength
+				|| teamStrength + data.HighestSums[row + rest] < data.MinPartialStrength);
+			if (outOfRange)
+			{
+				data.PartialFailedCount++;
+			}
+			else
+			{
+				for (; player != team.end(); ++player) teamStrength += ratings[*player];
+				outOfRange = std::abs(data.NeededTeamAverage - teamStrength) > data.MaxTeamDev;
+				data.TeamStrengths[teamIndex] = teamStrength;
+			}
+		}
+		if (outOfRange)
+		{
+			//This team is too good or too bad...
+			data.TeamValueFailedCount++;
+			return false;
+		}
+		return true;
+	}
+
+	bool GenerateTeams::AreRestrictionsValid(GenData& data, const Team& team)
+	{
+		if (data.Restrictions.empty()) return true;
+
+		data.RestrictionChecks++;
+		for (const auto& restriction : data.Restrictions)
+		{
+			if (!restriction->IsValidTeam(data.Players, team))
+			{
+				data.PlayerRestrictionsFailedCount++;
+				return false;
+			}
+		}
 		return true;
 	}
 
+	void GenerateTeams::ReorderChecks(GenData& data)
+	{
+		data.ChecksUntilReorder = REORDER_INTERVAL;
+		std::stable_sort(data.CheckOrder.begin(), data.CheckOrder.end(), [&data](std::uint8_t a, std::uint8_t b) {
+			return data.TeamRejects[a] > data.TeamRejects[b];
+		});
+		//Halving the counts lets the order follow the search when what it rejects changes, without forgetting everything at once
+		for (long& rejects : data.TeamRejects) rejects /= 2;
+
+		//Only the restrictions count how often they run. The strength check runs on every team the restrictions let through
+		//when they go first, and the restrictions run on every team it lets through otherwise
+		const long strengthRejects = data.TeamValueFailedCount - data.LastStrengthRejects;
+		const long restrictionRejects = data.PlayerRestrictionsFailedCount - data.LastRestrictionRejects;
+		const long strengthChecks = data.RestrictionsFirst ? data.RestrictionChecks - restrictionRejects : strengthRejects + data.RestrictionChecks;
+		//Compares the two rejection rates without dividing
+		data.RestrictionsFirst = static_cast<double>(restrictionRejects) * strengthChecks > static_cast<double>(strengthRejects) * data.RestrictionChecks;
+		data.LastStrengthRejects = data.TeamValueFailedCount;
+		data.LastRestrictionRejects = data.PlayerRestrictionsFailedCount;
+		data.RestrictionChecks = 0;
+
+		//The partial bound costs a compare on every team, and with tight rosters it hardly ever fires, so it is only kept while it pays for itself.
+		//While it is off it gets one period every so often to show whether the search moved somewhere it helps
+		const long partialRejects = data.PartialFailedCount - data.LastPartialRejects;
+		data.LastPartialRejects = data.PartialFailedCount;
+		if (data.UsePartialBound)
+		{
+			data.UsePartialBound = partialRejects * PARTIAL_BOUND_MIN_SHARE >= REORDER_INTERVAL;
+			data.PeriodsUntilProbe = PARTIAL_BOUND_PROBE_PERIODS;
+		}
+		else
+		{
+			data.UsePartialBound = --data.PeriodsUntilProbe == 0;
+		}
+	}
+
+	//Only runs once a team set passed every other check, so the quadratic pair count doesn't slow down the search
+	bool GenerateTeams::AreRepeatsValid(GenData& data)
+	{
+		if (data.Repeats.empty()) return true;
+
+		data.RepeatPenalty = data.KnownRepeats >= 0 ? data.KnownRepeats : GetRepeatPenalty(data, data.MaxRepeats);
+		if (data.MaxRepeats >= 0 && data.RepeatPenalty > data.MaxRepeats)
+		{
+			data.HistoryFailedCount++;
+			return false;
+		}
+		return true;
+	}
+
+	long GenerateTeams::GetRepeatPenalty(const GenData& data, long limit)
+	{
+		if (data.Repeats.empty()) return 0;
+
+		const std::size_t playerCount = data.Players.size();
+		const std::uint16_t* repeats = data.Repeats.data();
+		long penalty = 0;
+		int offset = 0;
+		for (std::uint8_t size : data.Sizes)
+		{
+			const std::uint8_t* team = &data.Teams[offset];
+			for (int a = 0; a < size; a++)
+			{
+				const std::uint16_t* row = repeats + team[a] * playerCount;
+				for (int b = a + 1; b < size; b++)
+				{
+					penalty += row[team[b]];
+				}
+			}
+			//Repeats only ever add up, so a set that is already over the limit can't come back under it
+			if (limit >= 0 && penalty > limit) return penalty;
+			offset += size;
+		}
+		return penalty;
+	}
+
+	double GenerateTeams::GetScore(const GenData& data, const TeamResult& result)
+	{
+		return result.Delta + data.HistoryWeight * result.Repeats;
+	}
+
 
 }
 
@@ -2,13 +2,23 @@
 
 #include <vector>
 #include <set>
+#include <map>
 #include <sstream>
 #include <chrono>
 #include <functional>
 #include <memory>
+#include <limits>
+#include <thread>
+#include <algorithm>
 
 #include "PlayerRestrictor.h"
 #include "Weights.h"
+#include "FixedPoint.h"
+#include "OutputWriter.h"
+#include "AxisBalance.h"
+#include "TeamHistory.h"
+#include "Profiler.h"
+#include "SearchProgress.h"
 #include "Main.h"
 
 namespace CWTeams
@@ -16,20 +26,98 @@ namespace CWTeams
 
 	struct TeamIterator;
 	struct ConstTeamIterator;
+	class ParetoArchive;
+
+	//A valid team set along with the strengths it had when it was checked, so sorting and printing never recompute them
+	struct TeamResult
+	{
+		TeamSet Teams;
+		std::vector<double> Strengths;
+		double Delta;
+		//How many times players on the same team were teammates before
+		long Repeats;
+	};
 
 	struct GenData
 	{
 		std::vector<CWPlayer>& Players;
-		std::vector<std::unique_ptr<PlayerRestriction>>& Restrictions;
+		std::vector<std::shared_ptr<PlayerRestriction>>& Restrictions;
 		FILE* Output;
 		WeightsData Weights;
 
 		TeamSet Teams;
 		TeamSizes Sizes;
 
+		//Valid team sets waiting to be sorted and printed
+		std::vector<TeamResult> Results;
+		//Each team's strength from the last call to AreTeamsValid. Only complete when it returned true
+		std::vector<double> TeamStrengths;
+		std::shared_ptr<OutputWriter> Writer;
+		std::function<void(const GenData&, const TeamResult&, int)> OnTeamSet;
+		SearchProgress* Progress = nullptr;
+
+		//Why candidates were rejected by AreTeamsValid
+		long TeamValueFailedCount;
+		long PlayerRestrictionsFailedCount;
+
 		double NeededTeamAverage;
 		double MaxTeamDev;
 
+		//Each player's weighted overall, computed once per match
+		std::vector<double> Ratings;
+
+		//The same ratings scaled to integers, along with the exact range a team's fixed strength must fall in
+		bool UseFixedPoint;
+		std::int64_t FixedScale;
+		std::vector<FixedRating> FixedRatings;
+		FixedRating MinFixedTeamStrength, MaxFixedTeamStrength;
+
+		//What the teams are summed from. Each player's overall under the weights for a team of every size, indexed [size * players + player],
+		//and where each team's row starts. Without per team weights there is a single row equal to Ratings that every team reads
+		std::vector<double> SizeRatings;
+		std::vector<FixedRating> FixedSizeRatings;
+		std::vector<std::size_t> TeamRows;
+
+		//The smallest and largest sums of k ratings in each row, indexed [row + k], so a team can be rejected after summing half of it
+		std::vector<double> LowestSums, HighestSums;
+		std::vector<FixedRating> FixedLowestSums, FixedHighestSums;
+		//The double range with a little slack, since a partial sum is added in a different order than the whole team
+		double MinPartialStrength, MaxPartialStrength;
+		bool UsePartialBound;
+		long PartialFailedCount, LastPartialRejects;
+		int PeriodsUntilProbe;
+
+		//Adaptive early reject. AreTeamsValid checks the teams in CheckOrder, the most often rejected first, and runs the restrictions
+		//before the strength check while they reject a larger share of the teams they see. Both are revisited every so many calls,
+		//from how often each team was rejected and the failed counts at the last reorder
+		std::vector<std::uint8_t> CheckOrder;
+		std::vector<long> TeamRejects;
+		long RestrictionChecks;
+		long LastStrengthRejects, LastRestrictionRejects;
+		bool RestrictionsFirst;
+		long ChecksUntilReorder;
+
+		//Balancing PVP, gamesense and teamwork separately on top of the overall rating. Each player's axes as fixed point integers,
+		//the range every team's sums must fall in, and how far apart the strongest and weakest team were on each axis in the last valid set
+		bool UseAxes;
+		std::vector<AxisVector> AxisRatings;
+		AxisVector MinAxisStrength, MaxAxisStrength;
+		AxisVector AxisSpread;
+		//Only the team sets no other set beats on every axis are kept when this is set
+		std::shared_ptr<ParetoArchive> Archive;
+		//When above 0 only this many pairwise different team sets are kept once the search is over
+		int DiverseCount = 0;
+
+		//How many times each pair of players was on the same team before, indexed [a * players + b]. Empty without a history.
+		//Along with the repeats of the last valid set, the most a set may have (negative for no limit) and what one repeat costs when ranking
+		std::vector<std::uint16_t> Repeats;
+		long RepeatPenalty;
+		//The repeats of the current team set when the engine already counted them while building it, negative when they must be counted
+		long KnownRepeats = -1;
+		long MaxRepeats;
+		double HistoryWeight;
+		long HistoryFailedCount;
+
 		TeamIterator begin();
 		TeamIterator end();
 		ConstTeamIterator begin() const;
@@ -66,33 +154,140 @@ namespace CWTeams
 
 	};
 	
+	//Every field defaults to what the command line uses when the option isn't given, except Seed which it picks at random
 	struct GenParameters
 	{
 		std::vector<CWPlayer> Players;
-		std::vector<std::unique_ptr<PlayerRestriction>> Restrictions;
+		std::vector<std::shared_ptr<PlayerRestriction>> Restrictions;
+		std::vector<std::string> Separations;
 		Weights WeightsMap;
-		double MaxDev;
-		int LimitOutput;
-		int TeamCount;
-		FILE* Output;
-		bool Sort;
-		int TimeoutSeconds;
+		double MaxDev = 1.0;
+		int LimitOutput = 1000;
+		//Must be filled in, there is no sensible default
+		int TeamCount = 0;
+		FILE* Output = stdout;
+		OutputFormat Format = OutputFormat::Text;
+		bool Sort = true;
+		//When false the team sets are only summarized, not printed
+		bool PrintTeams = true;
+		int TimeoutSeconds = 15;
+		std::uint64_t Seed = 0;
+		//Which of the seed's random streams the sampler draws from. Searches that run side by side from one seed, like the scenarios
+		//of a batch or the team counts of a sweep, each get their own Stream, and the layouts of one search their own Substream
+		int Stream = 0;
+		int Substream = 0;
+		double StopCoverage = 0.99;
+		bool CountOnly = false;
+		int Precision = 2;
+		bool FixedPoint = false;
+		std::string Engine = "auto";
+		int Threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+		//The max deviation for PVP, gamesense and teamwork team sums. Empty to only balance the overall rating
+		std::vector<double> AxisDeviation;
+		//Keep the Pareto front of the per axis spreads instead of every valid team set
+		bool Pareto = false;
+		//Past matches to avoid repeating teammates from, or null
+		std::shared_ptr<const TeamHistory> History;
+		double HistoryWeight = 0.1;
+		long MaxRepeats = -1;
+		//Keep only this many team sets, picked to be as different from each other as possible. 0 to keep them all
+		int Diverse = 0;
+		//How many players each team may have above or below an even split. 0 to only try the round robin sizes
+		int SizeSlack = 0;
+		//The team sizes to use instead of the round robin ones, largest first. Empty for round robin
+		TeamSizes Sizes;
+		//Score each team with the weights for its own size, like "3v", instead of the weights for the whole match
+		bool PerTeamWeights = false;
+		//When set, every team set that would be printed is handed to this instead of the output writer.
+		//Called from one thread at a time, as soon as each set is found unless Sort is set
+		std::function<void(const GenData&, const TeamResult&, int)> OnTeamSet;
+		//When set, the engine reports its setup, search and output stages here
+		Profiler* Profile = nullptr;
+		//When set, the engine counts what it looked at and found here and stops early once asked to
+		SearchProgress* Progress = nullptr;
+	};
+
+	//What a search found, so that callers can compare several searches
+	struct GenSummary
+	{
+		long ValidSets = 0;
+		//Whether every valid team set was found. For the sampler this is an estimate
+		bool Complete = false;
+		//Whether ValidSets is exactly how many valid team sets there are. The sampler only knows how many it found, so it never sets this
+		bool Exact = false;
+		//The smallest delta among the kept team sets, NaN if none were kept
+		double BestDelta = std::numeric_limits<double>::quiet_NaN();
 	};
 
 	class GenerateTeams
 	{
 	public:
-		static void Gen(GenParameters& params);
+		//Runs the engine selected by params, or only counts the valid team sets when CountOnly is set
+		static GenSummary Run(GenParameters& params);
 
-	private:
+		static bool IsKnownEngine(const std::string& engine);
+
+		//Parses one deviation used for every axis, or three comma separated ones for PVP, gamesense and teamwork
+		static bool ParseAxisDeviation(const std::string& value, std::vector<double>& result);
+
+		//The random sampling engine
+		static GenSummary Gen(GenParameters& params);
+
+		static TeamSizes GetRoundRobinSizes(int playerCount, int teamCount);
+
+		//Whether every team's overall, PVP, gamesense and teamwork sums fit the 32 bit lanes that balancing each axis uses
+		static bool DoAxesFit(const std::vector<CWPlayer>& players, const WeightsData& weights, int precision);
+
+		//Picks the team sizes and weights for the match and fills in the identity team mapping
+		static void Setup(GenParameters& params, GenData& data);
+
+		//Sorts data.Results from worst to best and prints them
 		static void PrintResults(GenData& data);
 
-		static double GetTeamStrength(const GenData& data, const Team& team);
+		//Fills in the best delta from data.Results, so it must be called before they are printed
+		static GenSummary Summarize(GenData& data, long validSets, bool complete, bool exact);
+
+		static double GetTeamStrength(const GenData& data, const Team& team, int teamIndex);
+		static FixedRating GetFixedTeamStrength(const GenData& data, const Team& team, int teamIndex);
 		static double GetTeamsDeltaStrength(const GenData& teams);
-		static void PrintTeam(const GenData& data, int ordal);
+		//Captures the current team set and the strengths AreTeamsValid cached for it
+		static TeamResult MakeResult(const GenData& data);
+		//How many times players on the same team in data were teammates before. Stops counting once past limit, unless it is negative
+		static long GetRepeatPenalty(const GenData& data, long limit = -1);
+		//What results are ranked by. The delta plus the cost of repeated teammates, lower is better
+		static double GetScore(const GenData& data, const TeamResult& result);
+
+		//Adds the current valid team set to results, or offers it to the Pareto archive
+		static void Keep(GenData& data, std::vector<TeamResult>& results);
+		//Prints the current team set right away
+		static void Print(GenData& data, int ordinal);
+		static void PrintTeam(const GenData& data, const TeamResult& result, int ordal);
 
 		static std::uint64_t GetTeamsHash(const GenData& data);
-		static bool AreTeamsValid(const GenData& data);
+		static bool AreTeamsValid(GenData& data);
+
+	private:
+		//How many repeated team sets must be drawn before the coverage estimate is trusted
+		static const long MIN_REPEATS_BEFORE_STOPPING = 32;
+		//How many candidates the sampler looks at between updates of the shared progress
+		static const long PROGRESS_INTERVAL = 4096;
+		//How many calls to AreTeamsValid go by between reordering its checks
+		static const long REORDER_INTERVAL = 1 << 16;
+		//The partial bound is kept while it rejects at least one in this many calls, and tried again this many reorders after it was turned off
+		static const long PARTIAL_BOUND_MIN_SHARE = 4;
+		static const int PARTIAL_BOUND_PROBE_PERIODS = 16;
+
+		static double EstimateTotalSets(std::size_t distinct, long seenOnce, long seenTwice);
+
+		static void SetupTeamRatings(GenParameters& params, GenData& data);
+		static void SetupEarlyReject(GenData& data);
+		static void SetupAxes(GenParameters& params, GenData& data);
+		static bool AreAxesValid(GenData& data);
+		static bool AreRepeatsValid(GenData& data);
+		static bool IsTeamInRange(GenData& data, const Team& team, int teamIndex);
+		static bool AreRestrictionsValid(GenData& data, const Team& team);
+		//Puts the checks that rejected the most since the last call first
+		static void ReorderChecks(GenData& data);
 
 	};
 }
@@ -0,0 +1,120 @@
+#include "Main.h"
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+#include <spdlog/async.h>
+#include <spdlog/sinks/base_sink.h>
+
+#include <condition_variable>
+#include <chrono>
+
+namespace CWTeams
+{
+	//Only added to the async logger. The queue hands it each flush after the messages logged before it, so it tells Flush when they are out
+	class FlushSignalSink : public spdlog::sinks::base_sink<spdlog::details::null_mutex>
+	{
+	public:
+		//Posts a flush through logger and waits until the queue has reached it
+		bool FlushAndWait(spdlog::logger& logger, std::chrono::milliseconds timeout)
+		{
+			std::unique_lock<std::mutex> lock(m_Lock);
+			long ticket = ++m_Posted;
+			logger.flush();
+			return m_Signal.wait_for(lock, timeout, [this, ticket] { return m_Done >= ticket; });
+		}
+
+	protected:
+		void sink_it_(const spdlog::details::log_msg&) override {}
+
+		void flush_() override
+		{
+			std::lock_guard<std::mutex> guard(m_Lock);
+			m_Done++;
+			m_Signal.notify_all();
+		}
+
+	private:
+		std::mutex m_Lock;
+		std::condition_variable m_Signal;
+		long m_Posted = 0, m_Done = 0;
+	};
+
+	//How long Flush waits for the queue. A flush can be dropped along with the oldest messages when the queue overruns
+	static const std::chrono::milliseconds FLUSH_TIMEOUT { 1000 };
+	static std::shared_ptr<FlushSignalSink> s_FlushSignal;
+
+	std::atomic<bool> Log::s_Init { false };
+	std::mutex Log::s_InitLock;
+	
+	std::shared_ptr<spdlog::logger> Log::s_Logger(nullptr), Log::s_SyncLogger(nullptr);
+	//Declared after the loggers so it is destroyed first, which writes out whatever is still queued while they are alive
+	std::shared_ptr<spdlog::details::thread_pool> Log::s_ThreadPool(nullptr);
+
+	void Log::Init()
+	{
+
+		std::lock_guard<std::mutex> guard(s_InitLock);
+		if (s_Init) return;
+
+		bool useFiles = true;
+		std::string consolePattern = "%^[%T] %n: %$%v", filePattern = "%n-%t:[%D %H:%M %S.%e] %l: %v";
+
+
+		auto stdOut = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+		stdOut->set_pattern(consolePattern);
+
+		s_SyncLogger = std::make_shared<spdlog::logger>("Null.Black", stdOut);
+		s_Logger = s_SyncLogger;
+
+		stdOut->set_level(spdlog::level::level_enum::trace);
+		s_Logger->set_level(spdlog::level::level_enum::trace);
+
+		Log::s_Init = true;
+		CW_TRACE("Logging Initalized");
+	}
+
+	void Log::EnableAsync(std::size_t queueSize)
+	{
+		if (!s_Init) Init();
+		std::lock_guard<std::mutex> guard(s_InitLock);
+		if (s_ThreadPool) return;
+
+		s_ThreadPool = std::make_shared<spdlog::details::thread_pool>(queueSize, 1);
+		s_FlushSignal = std::make_shared<FlushSignalSink>();
+		std::vector<spdlog::sink_ptr> sinks = s_SyncLogger->sinks();
+		sinks.push_back(s_FlushSignal);
+		auto logger = std::make_shared<spdlog::async_logger>(s_SyncLogger->name(), sinks.begin(), sinks.end(),
+			s_ThreadPool, spdlog::async_overflow_policy::overrun_oldest);
+		logger->set_level(s_SyncLogger->level());
+		s_Logger = logger;
+	}
+
+	void Log::Flush()
+	{
+		if (!s_Init) return;
+		std::shared_ptr<spdlog::logger> logger = s_Logger;
+		std::shared_ptr<FlushSignalSink> signal = s_FlushSignal;
+		if (signal && logger != s_SyncLogger)
+		{
+			signal->FlushAndWait(*logger, FLUSH_TIMEOUT);
+		}
+		else if (logger)
+		{
+			logger->flush();
+		}
+	}
+
+	void Log::Shutdown()
+	{
+		CW_TRACE("Destroying logging");
+		std::lock_guard<std::mutex> guard(s_InitLock);
+
+		s_Init = false;
+		s_Logger.reset();
+		s_SyncLogger.reset();
+		s_FlushSignal.reset();
+		//Waits for the queue to be written out
+		s_ThreadPool.reset();
+		
+	}
+
+}
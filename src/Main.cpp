@@ -4,22 +4,36 @@
 #include "Weights.h"
 #include "RatingsReader.h"
 #include "GenerateTeams.h"
+#include "BatchRunner.h"
+#include "TeamCountSweep.h"
+#include "Daemon.h"
+#include "Rebalance.h"
+#include "TeamHistory.h"
+#include "Profiler.h"
+#include "SearchProgress.h"
+#include "TeamBalancer.h"
 
 #include <filesystem>
+#include <random>
+#include <thread>
+#include <future>
 
 #include <spdlog/spdlog.h>
 #include <argparse/argparse.hpp>
-#include <spdlog/sinks/stdout_color_sinks.h>
 
 
 
+//Null when the file can't be opened, the caller reports it once nothing else is running
 FILE* CreateOutput(const std::string& outPath)
 {
-	return stdout;
+	return fopen(outPath.c_str(), "wb");
 }
 
 using namespace CWTeams;
 
+//How many messages --async-log can hold before the oldest are dropped
+static const std::size_t LOG_QUEUE_SIZE = 8192;
+
 int main(int argc, const char** argv)
 {
 	Log::Init();
@@ -45,8 +59,11 @@ int main(int argc, const char** argv)
 			.help("Sets a limit for the max number of permeated teams to be generated");
 
 	parser.add_argument("--teams", "-t")
-			.required().action([](const std::string& value) { return std::stoi(value); })
-			.help("How many teams should be made from the bundle of players");
+			.default_value(std::string("0"))
+			.help("How many teams should be made from the bundle of players. \"auto\" compares every team count like --teams-range");
+
+	parser.add_argument("--teams-range")
+			.help("Compares the team counts in a range like 2..5, reporting the best delta and number of valid team sets for each");
 
 	parser.add_argument("--separate", "-r")
 			.remaining()
@@ -55,6 +72,10 @@ int main(int argc, const char** argv)
 	parser.add_argument("--output", "-o")
 			.help("Write the list of teams to the specified file");
 
+	parser.add_argument("--format")
+			.default_value(std::string("text"))
+			.help("How team sets are written: text, jsonl (one JSON object per team set), csv (one row per player) or binary (a little endian header with the usernames, then a fixed size record of doubles and player indices per team set)");
+
 	parser.add_argument("--sort", "-s")
 			.default_value(true).action([](const std::string& value) { return value == "true"; })
 			.help("Waits until the program terminates to print the output (sorted from worst to best)");
@@ -63,12 +84,129 @@ int main(int argc, const char** argv)
 			.default_value(15).action([](const std::string& value) { return std::stoi(value); })
 			.help("How long the program can generate no more teams for until it exits");
 
+	parser.add_argument("--stop-coverage")
+			.default_value(0.99).action([](const std::string& value) { return std::stod(value); })
+			.help("Stops searching once this fraction of the estimated number of valid team sets has been found. Use a value above 1 to only stop on the timeout");
+
+	parser.add_argument("--engine")
+			.default_value(std::string("auto"))
+			.help("Search engine to use: sample (random shuffles), split (exhaustive meet-in-the-middle, 2 teams only), exhaustive (parallel enumeration of every team set) or auto which uses split for 2 teams of up to 40 players. Split doesn't use --seed and finds the most balanced splits first, so --limit keeps the best ones");
+
+	parser.add_argument("--threads")
+			.default_value(static_cast<int>(std::thread::hardware_concurrency())).action([](const std::string& value) { return std::stoi(value); })
+			.help("How many threads the exhaustive engine uses");
+
+	parser.add_argument("--count-only")
+			.default_value(false).implicit_value(true)
+			.help("Only prints how many valid team sets exist, computed exactly from ratings rounded to --precision decimal places");
+
+	parser.add_argument("--precision")
+			.default_value(2).action([](const std::string& value) { return std::stoi(value); })
+			.help("How many decimal places of each player's weighted rating are kept when ratings are quantized");
+
+	parser.add_argument("--fixed-point")
+			.default_value(false).implicit_value(true)
+			.help("Compares team strengths as integers with --precision decimal places so results don't depend on rounding or player order");
+
+	parser.add_argument("--axis-deviation")
+			.help("Also keeps each team's total PVP, gamesense and teamwork within this many points of their averages. One value for all three or three comma separated values");
+
+	parser.add_argument("--pareto")
+			.default_value(false).implicit_value(true)
+			.help("Only keeps the team sets that no other set beats on the spread of every axis at once (overall, PVP, gamesense and teamwork)");
+
+	parser.add_argument("--history")
+			.help("A file of past matches, one per line with teams separated by | and usernames by spaces. Team sets that put past teammates together again are ranked lower");
+
+	parser.add_argument("--history-weight")
+			.default_value(0.1).action([](const std::string& value) { return std::stod(value); })
+			.help("How many rating points of delta each repeated pair of teammates from --history is worth when ranking team sets");
+
+	parser.add_argument("--max-repeats")
+			.default_value(-1L).action([](const std::string& value) { return std::stol(value); })
+			.help("Drops team sets that repeat more than this many pairs of teammates from --history. Negative for no limit");
+
+	parser.add_argument("--profile")
+			.default_value(false).implicit_value(true)
+			.help("Measures the setup, search and output stages with hardware performance counters (cycles, instructions, cache and branch misses) where available, or the wall clock otherwise, and writes them to stderr");
+
+	parser.add_argument("--progress")
+			.default_value(0.0).action([](const std::string& value) { return std::stod(value); })
+			.help("Prints a JSON progress line to stderr every this many seconds while searching. 0 to turn it off");
+
+	parser.add_argument("--diverse")
+			.default_value(0).action([](const std::string& value) { return std::stoi(value); })
+			.help("Out of every valid team set found (see --limit), prints only this many that are balanced and as different from each other as possible, measured by how many pairs of teammates they don't share");
+
+	parser.add_argument("--size-slack")
+			.default_value(0).action([](const std::string& value) { return std::stoi(value); })
+			.help("Also tries uneven teams with up to this many players more or fewer than an even split, weighting each team with the weights for its own size (\"3v\" and so on). Team sets from different layouts are ranked by their delta as a share of the layout's average team strength");
+
+	parser.add_argument("--async-log")
+			.default_value(false).implicit_value(true)
+			.help("Writes log messages on a background thread so logging never holds up loading or searching. Drops the oldest messages if they pile up");
+
+	parser.add_argument("--batch")
+			.help("Runs every scenario listed in this job file against the same roster and weights, in parallel using --threads threads");
+
+	parser.add_argument("--daemon")
+			.help("Keeps the roster and weights loaded and answers balance requests on this Unix domain socket");
+
+	parser.add_argument("--client")
+			.help("Sends --request to the daemon listening on this Unix domain socket and prints its answer");
+
+	parser.add_argument("--request")
+			.help("The request --client sends, key=value pairs like in a batch job file (\"teams=3 max-deviation=1.5\"), \"reload\" or \"stop\". Required with --client");
+
+	parser.add_argument("--rebalance")
+			.help("Reads the current teams from this file, one team per line as usernames, and moves as few players as possible so they are balanced again after --join and --drop");
+
+	parser.add_argument("--join")
+			.default_value(std::string(""))
+			.help("Comma separated usernames of players joining the teams given to --rebalance");
+
+	parser.add_argument("--drop")
+			.default_value(std::string(""))
+			.help("Comma separated usernames of players leaving the teams given to --rebalance");
+
+	parser.add_argument("--max-moves")
+			.default_value(3).action([](const std::string& value) { return std::stoi(value); })
+			.help("The most players --rebalance may move to another team before giving up");
+
+	parser.add_argument("--seed")
+			.action([](const std::string& value) { return std::stoull(value); })
+			.help("Seeds the random number generator. Runs with the same seed and arguments produce the same teams");
+
 
 	try
 	{
 		GenParameters params;
 
 		parser.parse_args(argc, argv);
+		if (parser.get<bool>("--async-log"))
+		{
+			Log::EnableAsync(LOG_QUEUE_SIZE);
+		}
+
+		std::string daemonSocket, clientSocket;
+		try {
+			daemonSocket = parser.get<std::string>("--daemon");
+		} catch (std::logic_error& e) {}
+		try {
+			clientSocket = parser.get<std::string>("--client");
+		} catch (std::logic_error& e) {}
+
+		if (!clientSocket.empty())
+		{
+			//The client doesn't need any of the spreadsheets. There is no default request so a bare --client can't stop the daemon by accident
+			std::string request;
+			try {
+				request = parser.get<std::string>("--request");
+			} catch (std::logic_error& e) {
+				CW_FATAL("--client needs a --request to send, like \"teams=3\", \"reload\" or \"stop\"");
+			}
+			return Daemon::Request(clientSocket, request, stdout) ? 0 : 1;
+		}
 
 		std::string cwFile = parser.get<std::string>("--file");
 		if (!std::filesystem::exists(cwFile))
@@ -84,46 +222,193 @@ int main(int argc, const char** argv)
 		}
 		CW_SUCCESS("Found input weights file \"" + weightsFile + "\"");
 
-		Weights::Load(weightsFile, params.WeightsMap);
-
-		RatingsReader::ParsePlayers(cwFile, params.Players);
-
-		std::vector<std::string> restrictionStrings;
 		try
 		{
-			restrictionStrings = parser.get<std::vector<std::string>>("--separate");
+			params.Separations = parser.get<std::vector<std::string>>("--separate");
 		}
 		catch (std::logic_error& e) {
 			std::cout << "No files provided" << std::endl;
 		}
-		PlayerRestrictor::Restrict(params.Players, restrictionStrings, params.Restrictions);
 
 		params.MaxDev = parser.get<double>("--max-deviation");
 		params.LimitOutput = parser.get<int>("--limit");
-		params.TeamCount = parser.get<int>("--teams");
+		std::string teams = parser.get<std::string>("--teams");
+		try {
+			teams = parser.get<std::string>("--teams-range");
+		} catch (std::logic_error& e) {}
+
 		params.Sort = parser.get<bool>("--sort");
+		if (!OutputWriter::ParseFormat(parser.get<std::string>("--format"), params.Format))
+		{
+			CW_FATAL("Unknown output format \"{}\"", parser.get<std::string>("--format"));
+		}
+		params.PrintTeams = true;
 		params.TimeoutSeconds = parser.get<int>("--timeout");
+		params.StopCoverage = parser.get<double>("--stop-coverage");
+		params.CountOnly = parser.get<bool>("--count-only");
+		params.Precision = parser.get<int>("--precision");
+		params.FixedPoint = parser.get<bool>("--fixed-point");
+		params.Pareto = parser.get<bool>("--pareto");
+		try {
+			std::string axisDeviation = parser.get<std::string>("--axis-deviation");
+			if (!GenerateTeams::ParseAxisDeviation(axisDeviation, params.AxisDeviation))
+			{
+				CW_FATAL("Expected one or three comma separated axis deviations but got \"{}\"", axisDeviation);
+			}
+		} catch (std::logic_error& e) {}
+		params.Diverse = parser.get<int>("--diverse");
+		params.HistoryWeight = parser.get<double>("--history-weight");
+		params.MaxRepeats = parser.get<long>("--max-repeats");
+		try {
+			std::string historyFile = parser.get<std::string>("--history");
+			auto history = std::make_shared<TeamHistory>();
+			if (!TeamHistory::Load(historyFile, *history))
+			{
+				CW_FATAL("Failed to read match history \"{}\"", historyFile);
+			}
+			CW_SUCCESS("Read {} past matches from \"{}\"", history->GetMatchCount(), historyFile);
+			params.History = history;
+		} catch (std::logic_error& e) {}
+		params.Engine = parser.get<std::string>("--engine");
+		params.Threads = parser.get<int>("--threads");
+		params.SizeSlack = parser.get<int>("--size-slack");
 
 		try {
-			std::string outputFile = parser.get<std::string>("--output");
-			params.Output = CreateOutput(outputFile);
+			params.Seed = parser.get<unsigned long long>("--seed");
 		} catch (std::logic_error& e) {
-			params.Output = stdout;
+			std::random_device device;
+			params.Seed = (static_cast<std::uint64_t>(device()) << 32) | device();
 		}
 
+		std::string batchFile, rebalanceFile;
+		try {
+			batchFile = parser.get<std::string>("--batch");
+		} catch (std::logic_error& e) {}
+		try {
+			rebalanceFile = parser.get<std::string>("--rebalance");
+		} catch (std::logic_error& e) {}
+
+		//The arguments are parsed before the workbooks are loaded, so nothing exits while they are. Whether they make sense together
+		//is up to TeamBalancer::Validate once the players are known
+		int minTeams = 0, maxTeams = 0;
+		bool sweep = TeamCountSweep::ParseRange(teams, 0, minTeams, maxTeams);
+		if (!sweep)
+		{
+			try {
+				params.TeamCount = std::stoi(teams);
+			} catch (std::exception& e) {
+				CW_FATAL("Expected a team count, \"auto\" or a range like 2..5 but got \"{}\"", teams);
+			}
+		}
+		const bool singleRun = daemonSocket.empty() && rebalanceFile.empty() && batchFile.empty() && !sweep;
+		if (singleRun && params.TeamCount <= 0)
+		{
+			CW_FATAL("--teams is required and must be at least 1");
+		}
+		std::string outputFile;
+		if (singleRun)
+		{
+			try {
+				outputFile = parser.get<std::string>("--output");
+			} catch (std::logic_error& e) {}
+		}
+
+		//The two workbooks don't depend on each other, so they are parsed on their own threads and the restrictions are
+		//compiled right after the players. The loaders only report errors, which are logged once both are done
+		std::string weightsError, playersError;
+		std::future<bool> weightsLoaded = std::async(std::launch::async, [&]() { return Weights::TryLoad(weightsFile, params.WeightsMap, weightsError); });
+		std::future<bool> playersLoaded = std::async(std::launch::async, [&]() {
+			return RatingsReader::TryParsePlayers(cwFile, params.Players, playersError)
+				&& PlayerRestrictor::TryRestrict(params.Players, params.Separations, params.Restrictions, playersError);
+		});
 
-		CW_INFO("Using a max deviation of +-{} rating points", params.MaxDev);
-		CW_INFO(params.Sort ? "Sorting results" : "Not sorting results");
-		CW_INFO("Using a timeout of {} seconds", params.TimeoutSeconds);
-		CW_INFO("Limiting output to {} permutations", params.LimitOutput);
-		CW_INFO("Generating {} teams with a total playerbase of {} players", params.TeamCount, params.Players.size());
+		params.Output = outputFile.empty() ? stdout : CreateOutput(outputFile);
 
+		const bool weightsOk = weightsLoaded.get();
+		const bool playersOk = playersLoaded.get();
+		if (!weightsOk)
+		{
+			CW_FATAL(weightsError);
+		}
+		if (!playersOk)
+		{
+			CW_FATAL(playersError);
+		}
+		if (!params.Output)
+		{
+			CW_FATAL("Failed to open output file \"{}\"", outputFile);
+		}
+		if (sweep)
+		{
+			//"auto" goes up to half the players
+			TeamCountSweep::ParseRange(teams, static_cast<int>(params.Players.size()), minTeams, maxTeams);
+		}
+		//Batches, sweeps, rebalances and the daemon validate each search they run themselves
+		std::string error;
+		if (singleRun && !TeamBalancer::Validate(params, error))
+		{
+			CW_FATAL(error);
+		}
 
-		GenerateTeams::Gen(params);
+		if (!daemonSocket.empty())
+		{
+			Daemon::Serve(daemonSocket, cwFile, weightsFile, params);
+			return 0;
+		}
+		if (!rebalanceFile.empty())
+		{
+			params.Output = stdout;
+			return Rebalance::Run(params, rebalanceFile, Rebalance::SplitList(parser.get<std::string>("--join")),
+				Rebalance::SplitList(parser.get<std::string>("--drop")), parser.get<int>("--max-moves")) ? 0 : 1;
+		}
+		//Ctrl-C or a SIGTERM stops the search early but still sorts and prints what it found. The scenarios of a batch or sweep all share one
+		SearchProgress progress;
+		params.Progress = &progress;
+		SearchProgress::CatchSignals(&progress);
+		double progressInterval = parser.get<double>("--progress");
+		if (progressInterval > 0.0) progress.Start(progressInterval, stderr);
+
+		std::unique_ptr<Profiler> profiler;
+		int exitCode = 0;
+		if (!batchFile.empty())
+		{
+			params.Output = stdout;
+			if (!BatchRunner::Run(params, batchFile)) exitCode = 1;
+		}
+		else if (sweep)
+		{
+			params.Output = stdout;
+			TeamCountSweep::Run(params, minTeams, maxTeams);
+		}
+		else
+		{
+			CW_INFO("Using a max deviation of +-{} rating points", params.MaxDev);
+			CW_INFO(params.Sort ? "Sorting results" : "Not sorting results");
+			CW_INFO("Using a timeout of {} seconds", params.TimeoutSeconds);
+			CW_INFO("Stopping at {}% estimated coverage", params.StopCoverage * 100.0);
+			CW_INFO("Limiting output to {} permutations", params.LimitOutput);
+			CW_INFO("Using seed {}", params.Seed);
+			CW_INFO("Generating {} teams with a total playerbase of {} players", params.TeamCount, params.Players.size());
+
+			if (parser.get<bool>("--profile"))
+			{
+				profiler.reset(new Profiler());
+				params.Profile = profiler.get();
+			}
+			GenerateTeams::Run(params);
+		}
+		progress.Finish();
+		SearchProgress::CatchSignals(nullptr);
+		if (profiler) profiler->Report(stderr);
 		if (params.Output != stdout)
 		{
 			fclose(params.Output);
 		}
+		if (progress.GetSignal() != 0)
+		{
+			return 128 + progress.GetSignal();
+		}
+		return exitCode;
 
 #ifdef _WIN32
 		//system("PAUSE");
@@ -138,41 +423,3 @@ int main(int argc, const char** argv)
 
 }
 
-
-namespace CWTeams
-{
-	volatile bool Log::s_Init = false;
-	
-	std::unique_ptr<spdlog::logger> Log::s_Logger(nullptr);
-
-	void Log::Init()
-	{
-
-		if (s_Init) return;
-
-		bool useFiles = true;
-		std::string consolePattern = "%^[%T] %n: %$%v", filePattern = "%n-%t:[%D %H:%M %S.%e] %l: %v";
-
-
-		auto stdOut = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
-		stdOut->set_pattern(consolePattern);
-
-		s_Logger.reset(new spdlog::logger("Null.Black", { stdOut }));
-
-		stdOut->set_level(spdlog::level::level_enum::trace);
-		s_Logger->set_level(spdlog::level::level_enum::trace);
-
-		Log::s_Init = true;
-		CW_TRACE("Logging Initalized");
-	}
-
-	void Log::Shutdown()
-	{
-
-		s_Init = false;
-		CW_TRACE("Destroying logging");
-		s_Logger.reset(nullptr);
-		
-	}
-
-}
@@ -3,12 +3,16 @@
 #include <xlnt/xlnt.hpp>
 
 #include <string>
+#include <atomic>
+#include <mutex>
 
 #include <spdlog/spdlog.h>
 #include <spdlog/fmt/ostr.h>
 #include <stdio.h>
 #include<string.h>
 
+namespace spdlog { namespace details { class thread_pool; } }
+
 namespace CWTeams
 {
 
@@ -18,11 +22,33 @@ namespace CWTeams
 		static void Init();
 		static void Shutdown();
 
-		inline static spdlog::logger* GetLogger() { return s_Logger.get(); }
+		//Hands messages to a background thread through a queue of queueSize messages instead of writing them on the calling thread.
+		//When the queue is full the oldest messages are dropped rather than blocking. Call before starting any other threads
+		static void EnableAsync(std::size_t queueSize);
+
+		//Writes out everything logged so far. When logging is asynchronous this waits, up to a second, for the queue to get there
+		static void Flush();
+
+		//Initializes logging on first use so that programs embedding the library don't have to
+		inline static spdlog::logger* GetLogger()
+		{
+			if (!s_Init) Init();
+			return s_Logger.get();
+		}
+
+		//Writes on the calling thread even when logging is asynchronous
+		inline static spdlog::logger* GetSyncLogger()
+		{
+			if (!s_Init) Init();
+			return s_SyncLogger.get();
+		}
 
 	private:
-		static std::unique_ptr<spdlog::logger> s_Logger;
-		static volatile bool s_Init;
+		//Async loggers need to be shared since every queued message keeps its logger alive
+		static std::shared_ptr<spdlog::logger> s_Logger, s_SyncLogger;
+		static std::shared_ptr<spdlog::details::thread_pool> s_ThreadPool;
+		static std::atomic<bool> s_Init;
+		static std::mutex s_InitLock;
 	};
 
 	inline bool IEquals(const std::string& aStr, const std::string& bStr)
@@ -42,33 +68,46 @@ namespace CWTeams
 }
 
 
-int main(int argc, const char** argv);
+//Log calls below this level are compiled out together with the formatting of their arguments.
+//0 trace (which CW_SUCCESS also uses), 2 info, 3 warn, 4 error, the same as spdlog's levels. CW_FATAL is always kept since it exits
+#ifndef CW_LOG_LEVEL
+	#define CW_LOG_LEVEL 0
+#endif
 
-#if 1
+//What a compiled out call turns into. The arguments still count as used and the format string is still checked, but nothing runs
+#define CW_LOG_DISABLED(...)			do { if (false) (void) fmt::format(__VA_ARGS__); } while (0)
 
-	#define CW_SUCCESS(...)				CW_TRACE(__VA_ARGS__)
+#if CW_LOG_LEVEL <= 0
 	#define CW_TRACE(...)				::CWTeams::Log::GetLogger()->trace(__VA_ARGS__)
-	#define CW_INFO(...)				::CWTeams::Log::GetLogger()->info(__VA_ARGS__)
-	#define CW_WARN(...)				::CWTeams::Log::GetLogger()->warn(__VA_ARGS__)
-	#define CW_ERROR(...)				::CWTeams::Log::GetLogger()->error(__VA_ARGS__)
-
-	#ifdef _WIN32
-		#define CW_FATAL(...)			  { ::CWTeams::Log::GetLogger()->critical(__VA_ARGS__); system("PAUSE"); exit(1); }
-	#else
-		#define CW_FATAL(...)			  { ::CWTeams::Log::GetLogger()->critical(__VA_ARGS__); exit(1); }
-	#endif
+#else
+	#define CW_TRACE(...)				CW_LOG_DISABLED(__VA_ARGS__)
+#endif
+#define CW_SUCCESS(...)					CW_TRACE(__VA_ARGS__)
 
-	#define CW_LOG(level, ...)          ::CWTeams::Log::GetLogger()->log(level, __VA_ARGS__)
+#if CW_LOG_LEVEL <= 2
+	#define CW_INFO(...)				::CWTeams::Log::GetLogger()->info(__VA_ARGS__)
+#else
+	#define CW_INFO(...)				CW_LOG_DISABLED(__VA_ARGS__)
+#endif
 
+#if CW_LOG_LEVEL <= 3
+	#define CW_WARN(...)				::CWTeams::Log::GetLogger()->warn(__VA_ARGS__)
 #else
+	#define CW_WARN(...)				CW_LOG_DISABLED(__VA_ARGS__)
+#endif
 
-	#define CW_SUCCESS(...)
-	#define CW_TRACE(...)
-	#define CW_INFO(...)
-	#define CW_WARN(...)
-	#define CW_ERROR(...)
-	#define CW_FATAL(...)
-	#define CW_LOG(level, ...)
+#if CW_LOG_LEVEL <= 4
+	#define CW_ERROR(...)				::CWTeams::Log::GetLogger()->error(__VA_ARGS__)
+#else
+	#define CW_ERROR(...)				CW_LOG_DISABLED(__VA_ARGS__)
+#endif
 
+//Written synchronously even when logging is asynchronous, after whatever is still queued, so the message is out before the process exits
+#ifdef _WIN32
+	#define CW_FATAL(...)			  { ::CWTeams::Log::Flush(); ::CWTeams::Log::GetSyncLogger()->critical(__VA_ARGS__); system("PAUSE"); exit(1); }
+#else
+	#define CW_FATAL(...)			  { ::CWTeams::Log::Flush(); ::CWTeams::Log::GetSyncLogger()->critical(__VA_ARGS__); exit(1); }
 #endif
 
+//For a level only known at run time. Calls below CW_LOG_LEVEL are skipped, and compiled out when the level is a constant
+#define CW_LOG(level, ...)          do { if (static_cast<int>(level) >= CW_LOG_LEVEL) ::CWTeams::Log::GetLogger()->log(level, __VA_ARGS__); } while (0)
@@ -0,0 +1,210 @@
+#include "MixedSizes.h"
+
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+
+namespace CWTeams
+{
+
+	static std::string GetLayoutName(const TeamSizes& sizes)
+	{
+		std::stringstream ss;
+		for (int i = 0; i < sizes.size(); i++)
+		{
+			ss << (int) sizes[i];
+			if (i < sizes.size() - 1) ss << "v";
+		}
+		return ss.str();
+	}
+
+	std::vector<TeamSizes> MixedSizes::GetLayouts(int playerCount, int teamCount, int slack)
+	{
+		std::vector<TeamSizes> result;
+		if (teamCount < 1 || playerCount < teamCount) return result;
+
+		const int low = std::max(1, playerCount / teamCount - slack);
+		const int high = std::min<int>(std::numeric_limits<std::uint8_t>::max(), (playerCount + teamCount - 1) / teamCount + slack);
+		TeamSizes layout;
+		layout.reserve(teamCount);
+		AddLayouts(layout, teamCount, playerCount, low, high, result);
+		return result;
+	}
+
+	void MixedSizes::AddLayouts(TeamSizes& layout, int teamCount, int remaining, int low, int high, std::vector<TeamSizes>& result)
+	{
+		const int teamsLeft = teamCount - static_cast<int>(layout.size());
+		if (teamsLeft == 0)
+		{
+			if (remaining == 0) result.push_back(layout);
+			return;
+		}
+		//Sizes never increase, so each layout is only generated once
+		const int largest = layout.empty() ? high : std::min<int>(high, layout.back());
+		for (int size = largest; size >= low; size--)
+		{
+			//The teams after this one can't be larger than it or smaller than low
+			if (size * teamsLeft < remaining) break;
+			if (remaining - size < low * (teamsLeft - 1)) continue;
+			layout.push_back(static_cast<std::uint8_t>(size));
+			AddLayouts(layout, teamCount, remaining - size, low, high, result);
+			layout.pop_back();
+		}
+	}
+
+	bool MixedSizes::HasWeights(const Weights& weights, const TeamSizes& sizes)
+	{
+		WeightsData unused;
+		if (!weights.TrySelect(sizes, unused)) return false;
+		for (auto size : sizes)
+		{
+			if (!weights.TrySelectTeam(size, unused)) return false;
+		}
+		return true;
+	}
+
+	GenSummary MixedSizes::Gen(GenParameters& params)
+	{
+		if (params.Profile) params.Profile->Begin("setup");
+		const int playerCount = static_cast<int>(params.Players.size());
+
+		struct Entry
+		{
+			TeamSizes Sizes;
+			GenSummary Summary;
+			std::vector<TeamResult> Results;
+			//The strength every team of the layout is held to, which depends on the weights its team sizes use
+			double TeamAverage = 0.0;
+		};
+		std::vector<Entry> entries;
+		for (const TeamSizes& sizes : GetLayouts(playerCount, params.TeamCount, params.SizeSlack))
+		{
+			if (!HasWeights(params.WeightsMap, sizes))
+			{
+				CW_WARN("Skipping {} because some of its team sizes have no weights", GetLayoutName(sizes));
+				continue;
+			}
+			entries.push_back({ sizes, GenSummary(), {}, 0.0 });
+		}
+		if (entries.empty())
+		{
+			CW_FATAL("None of the ways to split {} players into {} teams within {} of an even split have weights", playerCount, params.TeamCount, params.SizeSlack);
+		}
+
+		int threadCount = std::max(1, std::min(params.Threads, static_cast<int>(entries.size())));
+		CW_INFO("Searching {} team size layouts using {} threads", entries.size(), threadCount);
+		if (params.Profile) params.Profile->Begin("search");
+		auto start = std::chrono::steady_clock::now();
+
+		std::atomic<std::size_t> next { 0 };
+		auto work = [&entries, &next, &params]()
+		{
+			for (std::size_t i = next++; i < entries.size(); i = next++)
+			{
+				Entry& entry = entries[i];
+				GenParameters layoutParams = params;
+				layoutParams.Sizes = entry.Sizes;
+				layoutParams.PerTeamWeights = true;
+				layoutParams.Sort = true;
+				layoutParams.PrintTeams = true;
+				layoutParams.Profile = nullptr;
+				//The layouts already run side by side
+				layoutParams.Threads = 1;
+				layoutParams.Substream = static_cast<int>(i);
+				//The sets from every layout are ranked together once they are all done
+				layoutParams.OnTeamSet = [&entry](const GenData& data, const TeamResult& result, int ordinal)
+				{
+					entry.TeamAverage = data.NeededTeamAverage;
+					entry.Results.push_back(result);
+				};
+				entry.Summary = GenerateTeams::Gen(layoutParams);
+			}
+		};
+		std::vector<std::thread> threads;
+		for (int i = 1; i < threadCount; i++)
+		{
+			threads.emplace_back(work);
+		}
+		work();
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+
+		if (params.Profile) params.Profile->Begin("output");
+		//Each team set is printed with a GenData for its own layout, which is all the output writer looks at
+		std::vector<GenData> views;
+		views.reserve(entries.size());
+		auto writer = std::make_shared<OutputWriter>(params.Output, params.Format);
+		struct Ranked
+		{
+			const TeamResult* Result;
+			const GenData* View;
+			double Score;
+		};
+		std::vector<Ranked> ranked;
+		//Each layout weights its teams differently, so a delta is only comparable with other layouts' relative to the strength its teams
+		//are held to. The deltas are ranked as a share of their layout's average, scaled back to rating points by the mean of the averages
+		double reference = 0.0;
+		int withResults = 0;
+		for (const Entry& entry : entries)
+		{
+			if (entry.Results.empty()) continue;
+			reference += entry.TeamAverage;
+			withResults++;
+		}
+		if (withResults > 0) reference /= withResults;
+		GenSummary summary;
+		summary.Complete = true;
+		summary.Exact = true;
+		for (const Entry& entry : entries)
+		{
+			views.push_back({ params.Players, params.Restrictions, params.Output });
+			GenData& view = views.back();
+			view.Sizes = entry.Sizes;
+			view.Writer = writer;
+			view.OnTeamSet = params.OnTeamSet;
+			view.HistoryWeight = params.HistoryWeight;
+			if (params.History) params.History->BuildRepeats(view.Players, view.Repeats);
+			const double scale = entry.TeamAverage > 0.0 ? reference / entry.TeamAverage : 1.0;
+			for (const TeamResult& result : entry.Results)
+			{
+				ranked.push_back({ &result, &view, result.Delta * scale + view.HistoryWeight * result.Repeats });
+			}
+
+			summary.ValidSets += entry.Summary.ValidSets;
+			summary.Complete = summary.Complete && entry.Summary.Complete;
+			summary.Exact = summary.Exact && entry.Summary.Exact;
+			std::string best = std::isnan(entry.Summary.BestDelta) ? "-" : std::to_string(entry.Summary.BestDelta);
+			CW_INFO("{}: {}{} valid team sets, best delta {}", GetLayoutName(entry.Sizes), entry.Summary.Exact ? "" : ">=", entry.Summary.ValidSets, best);
+		}
+
+		//Worst first so the best team set is printed last, like a single search does
+		std::sort(ranked.begin(), ranked.end(), [](const Ranked& a, const Ranked& b) { return a.Score > b.Score; });
+		if (ranked.size() > static_cast<std::size_t>(params.LimitOutput))
+		{
+			ranked.erase(ranked.begin(), ranked.end() - params.LimitOutput);
+		}
+		for (const Ranked& entry : ranked)
+		{
+			if (std::isnan(summary.BestDelta) || entry.Result->Delta < summary.BestDelta) summary.BestDelta = entry.Result->Delta;
+		}
+		if (params.PrintTeams)
+		{
+			int ordinal = static_cast<int>(ranked.size());
+			for (const Ranked& entry : ranked)
+			{
+				GenerateTeams::PrintTeam(*entry.View, *entry.Result, ordinal--);
+			}
+			writer->Flush();
+		}
+		if (params.Profile) params.Profile->End();
+
+		CW_SUCCESS("Searched {} team size layouts in {} seconds and kept the best {} of {} valid team sets", entries.size(), seconds, ranked.size(), summary.ValidSets);
+		return summary;
+	}
+
+}
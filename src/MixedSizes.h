@@ -0,0 +1,25 @@
+#pragma once
+
+#include "GenerateTeams.h"
+
+namespace CWTeams
+{
+
+	//Searches every way of splitting the players into TeamCount teams whose sizes are within SizeSlack of an even split,
+	//scoring each team with the weights for its own size, and keeps the best team sets across all of them
+	class MixedSizes
+	{
+	public:
+		static GenSummary Gen(GenParameters& params);
+
+		//Every team size layout within slack of an even split, largest team first
+		static std::vector<TeamSizes> GetLayouts(int playerCount, int teamCount, int slack);
+
+		//Whether there are weights for the whole layout and for a team of each of its sizes
+		static bool HasWeights(const Weights& weights, const TeamSizes& sizes);
+
+	private:
+		static void AddLayouts(TeamSizes& layout, int teamCount, int remaining, int low, int high, std::vector<TeamSizes>& result);
+
+	};
+}
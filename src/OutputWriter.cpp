@@ -0,0 +1,267 @@
+#include "OutputWriter.h"
+
+#include "GenerateTeams.h"
+
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <spdlog/fmt/fmt.h>
+
+namespace CWTeams
+{
+
+	static void AppendJsonString(std::string& out, const std::string& value)
+	{
+		out += '"';
+		for (char c : value)
+		{
+			if (c == '"' || c == '\\')
+			{
+				out += '\\';
+				out += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				fmt::format_to(std::back_inserter(out), "\\u{:04x}", static_cast<int>(c));
+			}
+			else
+			{
+				out += c;
+			}
+		}
+		out += '"';
+	}
+
+	static void AppendCsvField(std::string& out, const std::string& value)
+	{
+		if (value.find_first_of(",\"\n") == std::string::npos)
+		{
+			out += value;
+			return;
+		}
+		out += '"';
+		for (char c : value)
+		{
+			if (c == '"') out += '"';
+			out += c;
+		}
+		out += '"';
+	}
+
+	//Writes the value little endian whatever the machine is, doubles as their IEEE 754 bits
+	template<typename T>
+	static void AppendBinary(std::string& out, T value)
+	{
+		std::uint64_t bits = 0;
+		if constexpr (std::is_floating_point<T>::value)
+		{
+			static_assert(sizeof(T) <= sizeof(bits), "Only 32 and 64 bit floating point values are supported");
+			std::memcpy(&bits, &value, sizeof(T));
+		}
+		else
+		{
+			bits = static_cast<std::uint64_t>(value);
+		}
+		for (std::size_t i = 0; i < sizeof(T); i++)
+		{
+			out += static_cast<char>((bits >> (8 * i)) & 0xFF);
+		}
+	}
+
+	OutputWriter::OutputWriter(FILE* file, OutputFormat format, bool live) : file(file), format(format), live(live)
+	{
+		if (!live) pending.reserve(CHUNK_SIZE);
+	}
+
+	OutputWriter::~OutputWriter()
+	{
+		Flush();
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			stop = true;
+		}
+		wake.notify_one();
+		if (thread.joinable()) thread.join();
+	}
+
+	bool OutputWriter::ParseFormat(const std::string& name, OutputFormat& format)
+	{
+		if (name == "text") format = OutputFormat::Text;
+		else if (name == "jsonl") format = OutputFormat::JsonLines;
+		else if (name == "csv") format = OutputFormat::Csv;
+		else if (name == "binary") format = OutputFormat::Binary;
+		else return false;
+		return true;
+	}
+
+	void OutputWriter::Write(const GenData& data, const TeamResult& result, int ordinal)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		if (!headerWritten)
+		{
+			WriteHeader(data);
+			headerWritten = true;
+		}
+		switch (format)
+		{
+			case OutputFormat::Text: WriteText(data, result, ordinal); break;
+			case OutputFormat::JsonLines: WriteJson(data, result, ordinal); break;
+			case OutputFormat::Csv: WriteCsv(data, result, ordinal); break;
+			case OutputFormat::Binary: WriteBinary(data, result, ordinal); break;
+		}
+		if (live || pending.size() >= CHUNK_SIZE) Submit();
+	}
+
+	void OutputWriter::WriteLine(const std::string& line)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		pending += line;
+		pending += '\n';
+		if (live || pending.size() >= CHUNK_SIZE) Submit();
+	}
+
+	void OutputWriter::Flush()
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		if (!thread.joinable())
+		{
+			//Everything still fits in one chunk, so there is no point in starting the writer thread
+			if (!pending.empty()) fwrite(pending.data(), 1, pending.size(), file);
+			pending.clear();
+		}
+		else
+		{
+			Submit();
+			idle.wait(guard, [this]() { return chunks.empty() && !writing; });
+		}
+		if (file) fflush(file);
+	}
+
+	void OutputWriter::Submit()
+	{
+		if (pending.empty()) return;
+		if (!thread.joinable()) thread = std::thread(&OutputWriter::Run, this);
+
+		chunks.push_back(std::move(pending));
+		pending = std::string();
+		if (!live) pending.reserve(CHUNK_SIZE);
+		wake.notify_one();
+	}
+
+	void OutputWriter::Run()
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		while (true)
+		{
+			wake.wait(guard, [this]() { return stop || !chunks.empty(); });
+			if (chunks.empty()) return;
+
+			//Live writers hand over one small chunk per team set, so whatever piled up is written together
+			std::string chunk = std::move(chunks.front());
+			chunks.pop_front();
+			while (!chunks.empty())
+			{
+				chunk += chunks.front();
+				chunks.pop_front();
+			}
+			writing = true;
+			guard.unlock();
+			fwrite(chunk.data(), 1, chunk.size(), file);
+			if (live) fflush(file);
+			guard.lock();
+			writing = false;
+			idle.notify_all();
+		}
+	}
+
+	void OutputWriter::WriteHeader(const GenData& data)
+	{
+		if (format == OutputFormat::Csv)
+		{
+			pending += "set,delta,team,strength,username,name\n";
+		}
+		else if (format == OutputFormat::Binary)
+		{
+			//"CWTB", version, team count, player count, each team's size, then each username prefixed by its length (a uint8, TeamBalancer::Validate rejects longer names).
+			//Every record after that is the set number (uint32), the delta, each team's strength (doubles) and the player index of every slot (uint8).
+			//Every number is little endian and the doubles are IEEE 754, so the files read the same on any machine
+			pending += "CWTB";
+			AppendBinary<std::uint8_t>(pending, 1);
+			AppendBinary<std::uint8_t>(pending, static_cast<std::uint8_t>(data.Sizes.size()));
+			AppendBinary<std::uint8_t>(pending, static_cast<std::uint8_t>(data.Players.size()));
+			pending.append(data.Sizes.begin(), data.Sizes.end());
+			for (const auto& player : data.Players)
+			{
+				AppendBinary<std::uint8_t>(pending, static_cast<std::uint8_t>(player.Username.size()));
+				pending += player.Username;
+			}
+		}
+	}
+
+	void OutputWriter::WriteText(const GenData& data, const TeamResult& result, int ordinal)
+	{
+		auto out = std::back_inserter(pending);
+		fmt::format_to(out, "\nTEAM-SET #{} - delta: {:f}", ordinal, result.Delta);
+		if (!data.Repeats.empty()) fmt::format_to(out, " - repeats: {}", result.Repeats);
+		pending += '\n';
+		int playerIndex = 0;
+		for (int t = 0; t < data.Sizes.size(); t++)
+		{
+			fmt::format_to(out, "\tTeam #{} strength {:f}\n", t, result.Strengths[t]);
+			for (int i = 0; i < data.Sizes[t]; i++)
+			{
+				const CWPlayer& player = data.Players[result.Teams[playerIndex++]];
+				fmt::format_to(out, "\t\t{} ({})\n", player.RealName, player.Username);
+			}
+		}
+	}
+
+	void OutputWriter::WriteJson(const GenData& data, const TeamResult& result, int ordinal)
+	{
+		fmt::format_to(std::back_inserter(pending), "{{\"set\":{},\"delta\":{},", ordinal, result.Delta);
+		if (!data.Repeats.empty()) fmt::format_to(std::back_inserter(pending), "\"repeats\":{},", result.Repeats);
+		pending += "\"teams\":[";
+		int playerIndex = 0;
+		for (int t = 0; t < data.Sizes.size(); t++)
+		{
+			fmt::format_to(std::back_inserter(pending), "{}{{\"strength\":{},\"players\":[", t == 0 ? "" : ",", result.Strengths[t]);
+			for (int i = 0; i < data.Sizes[t]; i++)
+			{
+				if (i > 0) pending += ',';
+				AppendJsonString(pending, data.Players[result.Teams[playerIndex++]].Username);
+			}
+			pending += "]}";
+		}
+		pending += "]}\n";
+	}
+
+	void OutputWriter::WriteCsv(const GenData& data, const TeamResult& result, int ordinal)
+	{
+		int playerIndex = 0;
+		for (int t = 0; t < data.Sizes.size(); t++)
+		{
+			for (int i = 0; i < data.Sizes[t]; i++)
+			{
+				const CWPlayer& player = data.Players[result.Teams[playerIndex++]];
+				fmt::format_to(std::back_inserter(pending), "{},{:f},{},{:f},", ordinal, result.Delta, t, result.Strengths[t]);
+				AppendCsvField(pending, player.Username);
+				pending += ',';
+				AppendCsvField(pending, player.RealName);
+				pending += '\n';
+			}
+		}
+	}
+
+	void OutputWriter::WriteBinary(const GenData& data, const TeamResult& result, int ordinal)
+	{
+		AppendBinary<std::uint32_t>(pending, static_cast<std::uint32_t>(ordinal));
+		AppendBinary<double>(pending, result.Delta);
+		for (double strength : result.Strengths)
+		{
+			AppendBinary<double>(pending, strength);
+		}
+		pending.append(result.Teams.begin(), result.Teams.end());
+	}
+
+}
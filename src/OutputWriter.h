@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <stdio.h>
+
+namespace CWTeams
+{
+
+	struct GenData;
+	struct TeamResult;
+
+	enum class OutputFormat
+	{
+		//The human readable TEAM-SET listing
+		Text,
+		//One JSON object per team set
+		JsonLines,
+		//One row per player
+		Csv,
+		//A header with the usernames followed by fixed size records of player indices. Numbers are little endian, see WriteHeader
+		Binary,
+	};
+
+	//Formats team sets into large chunks and writes them to a file on a background thread,
+	//so a search that prints millions of results spends its time searching instead of waiting on fprintf.
+	//A live writer hands over and flushes every team set right away instead, for unsorted output that is watched as it is found
+	class OutputWriter
+	{
+	public:
+		OutputWriter(FILE* file, OutputFormat format, bool live = false);
+		~OutputWriter();
+
+		OutputWriter(const OutputWriter& other) = delete;
+		OutputWriter& operator=(const OutputWriter& other) = delete;
+
+		//Safe to call from several threads at once
+		void Write(const GenData& data, const TeamResult& result, int ordinal);
+		//Adds a line of free text between team sets, like the moves of a rebalance
+		void WriteLine(const std::string& line);
+
+		//Blocks until everything written so far has reached the file
+		void Flush();
+
+		static bool ParseFormat(const std::string& name, OutputFormat& format);
+
+		//The binary header stores each username's length in one byte, so rosters with longer names can't be written in it
+		static const std::size_t MAX_BINARY_USERNAME = 255;
+
+	private:
+		void WriteHeader(const GenData& data);
+		void WriteText(const GenData& data, const TeamResult& result, int ordinal);
+		void WriteJson(const GenData& data, const TeamResult& result, int ordinal);
+		void WriteCsv(const GenData& data, const TeamResult& result, int ordinal);
+		void WriteBinary(const GenData& data, const TeamResult& result, int ordinal);
+
+		//Hands the pending chunk to the writer thread, starting it if needed. lock must be held
+		void Submit();
+		void Run();
+
+		//How much formatted output is collected before it is handed to the writer thread
+		static const std::size_t CHUNK_SIZE = 1 << 20;
+
+		FILE* file;
+		OutputFormat format;
+		bool live;
+		bool headerWritten = false;
+
+		std::mutex lock;
+		std::condition_variable wake, idle;
+		std::string pending;
+		std::deque<std::string> chunks;
+		bool writing = false, stop = false;
+		std::thread thread;
+
+	};
+}
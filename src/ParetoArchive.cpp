@@ -0,0 +1,63 @@
+#include "ParetoArchive.h"
+
+#include <algorithm>
+
+namespace CWTeams
+{
+
+	bool ParetoArchive::Insert(const AxisVector& spread, const GenData& data)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		const std::int32_t first = spread.Lanes[0];
+		auto before = [](std::int32_t value, const Entry& entry) { return value < entry.Spread.Lanes[0]; };
+		auto after = [](const Entry& entry, std::int32_t value) { return entry.Spread.Lanes[0] < value; };
+
+		//Anything that dominates the new entry is at least as good on the first axis
+		auto end = std::upper_bound(front.begin(), front.end(), first, before);
+		for (auto it = front.begin(); it != end; ++it)
+		{
+			if (Axes::Dominates(it->Spread, spread)) return false;
+		}
+
+		//Anything it dominates is at most as good on the first axis. Compact those away in one pass and free their slots
+		std::size_t begin = std::lower_bound(front.begin(), front.end(), first, after) - front.begin();
+		std::size_t kept = begin;
+		for (std::size_t i = begin; i < front.size(); i++)
+		{
+			if (Axes::Dominates(spread, front[i].Spread))
+			{
+				freeSlots.push_back(front[i].Slot);
+				continue;
+			}
+			front[kept++] = front[i];
+		}
+		front.resize(kept);
+
+		std::uint32_t slot;
+		if (freeSlots.empty())
+		{
+			slot = static_cast<std::uint32_t>(results.size());
+			results.push_back(GenerateTeams::MakeResult(data));
+		}
+		else
+		{
+			slot = freeSlots.back();
+			freeSlots.pop_back();
+			results[slot] = GenerateTeams::MakeResult(data);
+		}
+		front.insert(std::upper_bound(front.begin(), front.end(), first, before), Entry { spread, slot });
+		return true;
+	}
+
+	void ParetoArchive::MoveTo(std::vector<TeamResult>& output)
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		for (const Entry& entry : front)
+		{
+			output.push_back(std::move(results[entry.Slot]));
+		}
+		front.clear();
+		results.clear();
+		freeSlots.clear();
+	}
+}
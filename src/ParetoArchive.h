@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+#include "GenerateTeams.h"
+#include "AxisBalance.h"
+
+namespace CWTeams
+{
+
+	//Keeps every team set that no other team set beats on all axes at once, where each axis is scored by how far apart
+	//the strongest and weakest teams are. Entries are sorted by the first axis, so only the ones before a new entry can
+	//dominate it and only the ones after it can be dominated by it
+	class ParetoArchive
+	{
+	public:
+		//Adds the team set data currently holds unless something in the archive dominates it, and drops whatever it dominates.
+		//Safe to call from several threads at once. Returns false if the team set was dominated
+		bool Insert(const AxisVector& spread, const GenData& data);
+
+		//Moves the whole front into results
+		void MoveTo(std::vector<TeamResult>& results);
+
+	private:
+		//The sorted front only holds the spreads and where each team set is kept, so inserting in the middle moves a few bytes per entry
+		struct Entry
+		{
+			AxisVector Spread;
+			std::uint32_t Slot;
+		};
+
+		std::mutex lock;
+		std::vector<Entry> front;
+		//The team sets in no particular order. Slots freed by dominated entries are reused
+		std::vector<TeamResult> results;
+		std::vector<std::uint32_t> freeSlots;
+
+	};
+}
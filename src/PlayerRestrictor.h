@@ -80,35 +80,56 @@ namespace CWTeams
 		}
 
 		//Parses player restrictions from the list of strings specified by the command line agrument
-		static void Restrict(const std::vector<CWPlayer>& players, const std::vector<std::string>& restrictions, std::vector<std::unique_ptr<PlayerRestriction>>& result)
+		static void Restrict(const std::vector<CWPlayer>& players, const std::vector<std::string>& restrictions, std::vector<std::shared_ptr<PlayerRestriction>>& result)
+		{
+			std::string error;
+			if (!TryRestrict(players, restrictions, result, error))
+			{
+				CW_FATAL(error);
+			}
+		}
+
+		//Like Restrict but returns false with the reason in error instead of exiting on an invalid separation
+		static bool TryRestrict(const std::vector<CWPlayer>& players, const std::vector<std::string>& restrictions, std::vector<std::shared_ptr<PlayerRestriction>>& result, std::string& error)
 		{
 			for (auto& arg : restrictions)
 			{
 				std::size_t index = arg.find(':');
 				if (index == std::string::npos)
 				{
-					CW_FATAL("Expected colon (:) when specifying which players to separate: " + arg);
+					error = "Expected colon (:) when specifying which players to separate: " + arg;
+					return false;
 				}
 				std::string aUsername(arg.begin(), arg.begin() + index);
 				std::string bUsername(arg.begin() + index + 1, arg.end());
 				if (bUsername.find(':') != std::string::npos)
 				{
-					CW_FATAL("Multiple colons (:) are not allowed when specifying which players to separate: " + arg);
+					error = "Multiple colons (:) are not allowed when specifying which players to separate: " + arg;
+					return false;
 				}
 
 				if (!ContainsUsername(players, aUsername))
 				{
-					CW_FATAL("Failed to find player \"" + aUsername + "\" separation wanted from arg: \"" + arg + "\"");
+					error = "Failed to find player \"" + aUsername + "\" separation wanted from arg: \"" + arg + "\"";
+					return false;
 				}
 				if (!ContainsUsername(players, bUsername))
 				{
-					CW_FATAL("Failed to find player \"" + bUsername + "\" separation wanted from arg: \"" + arg + "\"");
+					error = "Failed to find player \"" + bUsername + "\" separation wanted from arg: \"" + arg + "\"";
+					return false;
+				}
+
+				if (IEquals(aUsername, bUsername))
+				{
+					error = "Can't separate player \"" + aUsername + "\" from themselves: \"" + arg + "\"";
+					return false;
 				}
 
 				CW_INFO("Separating players " + aUsername + " and " + bUsername);
-				//result.emplace_back(new BinaryPlayerRestriction(aUsername, bUsername));
+				//make_shared deletes through the derived type, PlayerRestriction's destructor isn't virtual
+				result.push_back(std::make_shared<BinaryPlayerRestriction>(aUsername, bUsername));
 			}
-
+			return true;
 		}
 
 	};
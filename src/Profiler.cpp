@@ -0,0 +1,154 @@
+#include "Profiler.h"
+
+#include "Main.h"
+
+#ifdef __linux__
+	#include <linux/perf_event.h>
+	#include <sys/ioctl.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+	#include <cstring>
+	#include <cerrno>
+#endif
+
+namespace CWTeams
+{
+
+	static const char* COUNTER_NAMES[] = { "cycles", "instructions", "cache misses", "branch misses" };
+
+	Profiler::Profiler()
+	{
+		for (int& fd : fds) fd = -1;
+#ifdef __linux__
+		const std::uint64_t configs[] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+		available = true;
+		for (int i = 0; i < PROFILE_COUNTER_COUNT; i++)
+		{
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = configs[i];
+			//The exhaustive engine searches on worker threads started after this, so count them too
+			attr.inherit = 1;
+			//User space only, which is all that perf_event_paranoid 2 allows and all the search does anyway
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			//Other processes may be using the counters too, so these let Read scale up for the time this one wasn't scheduled
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+			if (fds[i] < 0)
+			{
+				CW_WARN("Hardware counter \"{}\" is unavailable ({}). Profiling with the wall clock only", COUNTER_NAMES[i], std::strerror(errno));
+				available = false;
+				break;
+			}
+		}
+		if (!available)
+		{
+			for (int& fd : fds)
+			{
+				if (fd >= 0) close(fd);
+				fd = -1;
+			}
+		}
+#else
+		CW_WARN("Hardware counters are only supported on Linux. Profiling with the wall clock only");
+#endif
+	}
+
+	Profiler::~Profiler()
+	{
+#ifdef __linux__
+		for (int fd : fds)
+		{
+			if (fd >= 0) close(fd);
+		}
+#endif
+	}
+
+	Profiler::Reading Profiler::Read() const
+	{
+		Reading reading;
+		reading.Time = std::chrono::steady_clock::now();
+		for (int i = 0; i < PROFILE_COUNTER_COUNT; i++)
+		{
+			reading.Values[i] = 0;
+#ifdef __linux__
+			std::uint64_t values[3];
+			if (available && read(fds[i], values, sizeof(values)) == sizeof(values) && values[2] > 0)
+			{
+				reading.Values[i] = values[2] < values[1] ? static_cast<std::uint64_t>(static_cast<double>(values[0]) * values[1] / values[2]) : values[0];
+			}
+#endif
+		}
+		return reading;
+	}
+
+	void Profiler::Begin(const std::string& stage)
+	{
+		End();
+		stages.push_back({ stage });
+		running = true;
+		stageStart = Read();
+	}
+
+	void Profiler::End()
+	{
+		if (!running) return;
+		Reading now = Read();
+		ProfileStage& stage = stages.back();
+		stage.Seconds = std::chrono::duration_cast<std::chrono::microseconds>(now.Time - stageStart.Time).count() / 1000000.0;
+		for (int i = 0; i < PROFILE_COUNTER_COUNT; i++)
+		{
+			stage.Counters[i] = now.Values[i] - stageStart.Values[i];
+		}
+		running = false;
+	}
+
+	void Profiler::SetWork(long work, const std::string& unit)
+	{
+		this->work = work;
+		this->unit = unit;
+	}
+
+	void Profiler::Report(FILE* file) const
+	{
+		std::string report;
+		auto out = std::back_inserter(report);
+		fmt::format_to(out, "Profile ({})\n", available ? "hardware counters" : "wall clock only");
+		for (const ProfileStage& stage : stages)
+		{
+			if (!available)
+			{
+				fmt::format_to(out, "\t{}: {:.6f} seconds\n", stage.Name, stage.Seconds);
+				continue;
+			}
+			const std::uint64_t* c = stage.Counters;
+			const double cycles = static_cast<double>(c[PROFILE_CYCLES]);
+			const double instructions = static_cast<double>(c[PROFILE_INSTRUCTIONS]);
+			fmt::format_to(out, "\t{}: {:.6f} seconds, {} cycles, {} instructions, {:.2f} IPC, {} cache misses, {} branch misses\n", stage.Name, stage.Seconds,
+				c[PROFILE_CYCLES], c[PROFILE_INSTRUCTIONS], cycles > 0 ? instructions / cycles : 0.0,
+				c[PROFILE_CACHE_MISSES], c[PROFILE_BRANCH_MISSES]);
+		}
+
+		for (const ProfileStage& stage : stages)
+		{
+			if (work <= 0 || stage.Name != "search") continue;
+			const double n = static_cast<double>(work);
+			if (!available)
+			{
+				fmt::format_to(out, "Per {}: {:.2f} nano seconds\n", unit, stage.Seconds / n * 1000000000.0);
+				continue;
+			}
+			const std::uint64_t* c = stage.Counters;
+			fmt::format_to(out, "Per {}: {:.2f} nano seconds, {:.2f} cycles, {:.2f} instructions, {:.4f} cache misses, {:.4f} branch misses\n", unit,
+				stage.Seconds / n * 1000000000.0, c[PROFILE_CYCLES] / n, c[PROFILE_INSTRUCTIONS] / n,
+				c[PROFILE_CACHE_MISSES] / n, c[PROFILE_BRANCH_MISSES] / n);
+		}
+
+		fputs(report.c_str(), file);
+		fflush(file);
+	}
+}
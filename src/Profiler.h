@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+
+namespace CWTeams
+{
+
+	//Indices into ProfileStage::Counters
+	enum ProfileCounter
+	{
+		PROFILE_CYCLES,
+		PROFILE_INSTRUCTIONS,
+		PROFILE_CACHE_MISSES,
+		PROFILE_BRANCH_MISSES,
+		PROFILE_COUNTER_COUNT,
+	};
+
+	struct ProfileStage
+	{
+		std::string Name;
+		double Seconds = 0.0;
+		std::uint64_t Counters[PROFILE_COUNTER_COUNT] = {};
+	};
+
+	//Measures each stage of a search with the CPU's performance counters through perf_event_open.
+	//Where those aren't available (not Linux, no PMU in a VM, perf_event_paranoid too high) only the wall clock time is measured
+	class Profiler
+	{
+	public:
+		Profiler();
+		~Profiler();
+
+		Profiler(const Profiler& other) = delete;
+		Profiler& operator=(const Profiler& other) = delete;
+
+		//Ends the current stage, if any, and starts measuring a new one
+		void Begin(const std::string& stage);
+		void End();
+
+		//How much work the search stage did, like the number of configurations the sampler evaluated
+		void SetWork(long work, const std::string& unit);
+
+		bool HasCounters() const { return available; }
+
+		//Writes every stage and the search costs per unit of work to file. Not logged, so it shows up whatever CW_LOG_LEVEL is
+		void Report(FILE* file) const;
+
+	private:
+		struct Reading
+		{
+			std::uint64_t Values[PROFILE_COUNTER_COUNT];
+			std::chrono::steady_clock::time_point Time;
+		};
+
+		Reading Read() const;
+
+		int fds[PROFILE_COUNTER_COUNT];
+		bool available = false;
+
+		std::vector<ProfileStage> stages;
+		bool running = false;
+		Reading stageStart;
+
+		long work = 0;
+		std::string unit;
+
+	};
+}
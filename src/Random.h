@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <utility>
+
+namespace CWTeams
+{
+
+	//xoshiro256** (Blackman & Vigna). Much faster and better distributed than std::default_random_engine,
+	//and it can jump ahead 2^192 or 2^128 outputs so every search and every part of one can own a non-overlapping stream of the same seed
+	class Random
+	{
+	public:
+		using result_type = std::uint64_t;
+
+		Random(std::uint64_t seed = 0)
+		{
+			Seed(seed);
+		}
+
+		//Returns the generator for substream #subindex of stream #index of seed. Streams are 2^192 outputs apart and the substreams
+		//of one stream 2^128 apart, so none of them overlap. The same arguments always produce the same sequence
+		static Random Stream(std::uint64_t seed, int index, int subindex = 0)
+		{
+			Random result(seed);
+			for (int i = 0; i < index; i++)
+			{
+				result.LongJump();
+			}
+			for (int i = 0; i < subindex; i++)
+			{
+				result.Jump();
+			}
+			return result;
+		}
+
+		void Seed(std::uint64_t seed)
+		{
+			//Expand the seed with splitmix64 so that similar seeds still give unrelated states
+			for (auto& word : state)
+			{
+				seed += 0x9E3779B97F4A7C15ULL;
+				std::uint64_t z = seed;
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+				word = z ^ (z >> 31);
+			}
+		}
+
+		std::uint64_t Next()
+		{
+			const std::uint64_t result = Rotl(state[1] * 5, 7) * 9;
+			const std::uint64_t t = state[1] << 17;
+
+			state[2] ^= state[0];
+			state[3] ^= state[1];
+			state[1] ^= state[2];
+			state[0] ^= state[3];
+			state[2] ^= t;
+			state[3] = Rotl(state[3], 45);
+
+			return result;
+		}
+
+		//Returns a uniform integer in [0, range) using Lemire's multiply-shift method.
+		//The rejection step only triggers for the few low products that would bias the result
+		std::uint32_t Bounded(std::uint32_t range)
+		{
+			std::uint64_t product = static_cast<std::uint64_t>(Next() >> 32) * range;
+			std::uint32_t low = static_cast<std::uint32_t>(product);
+			if (low < range)
+			{
+				const std::uint32_t threshold = (0u - range) % range;
+				while (low < threshold)
+				{
+					product = static_cast<std::uint64_t>(Next() >> 32) * range;
+					low = static_cast<std::uint32_t>(product);
+				}
+			}
+			return static_cast<std::uint32_t>(product >> 32);
+		}
+
+		//Fisher-Yates shuffle that stops after the first count positions.
+		//The first count elements are a uniformly random selection in random order, the rest are whatever is left over
+		template<typename T>
+		void PartialShuffle(std::vector<T>& values, std::size_t count)
+		{
+			if (values.empty()) return;
+			const std::size_t size = values.size();
+			if (count >= size) count = size - 1;
+			for (std::size_t i = 0; i < count; i++)
+			{
+				std::size_t j = i + Bounded(static_cast<std::uint32_t>(size - i));
+				std::swap(values[i], values[j]);
+			}
+		}
+
+		template<typename T>
+		void Shuffle(std::vector<T>& values)
+		{
+			if (values.empty()) return;
+			PartialShuffle(values, values.size() - 1);
+		}
+
+		//Advances the state by 2^128 calls to Next()
+		void Jump()
+		{
+			static const std::uint64_t JUMP[] = { 0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL };
+			JumpBy(JUMP);
+		}
+
+		//Advances the state by 2^192 calls to Next()
+		void LongJump()
+		{
+			static const std::uint64_t LONG_JUMP[] = { 0x76E15D3EFEFDCBBFULL, 0xC5004E441C522FB3ULL, 0x77710069854EE241ULL, 0x39109BB02ACBE635ULL };
+			JumpBy(LONG_JUMP);
+		}
+
+		result_type operator()() { return Next(); }
+		static constexpr result_type min() { return 0; }
+		static constexpr result_type max() { return std::numeric_limits<result_type>::max(); }
+
+	private:
+		static std::uint64_t Rotl(std::uint64_t x, int k)
+		{
+			return (x << k) | (x >> (64 - k));
+		}
+
+		//Applies a jump polynomial to the state
+		void JumpBy(const std::uint64_t (&polynomial)[4])
+		{
+			std::uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+			for (std::uint64_t jump : polynomial)
+			{
+				for (int b = 0; b < 64; b++)
+				{
+					if (jump & (std::uint64_t(1) << b))
+					{
+						s0 ^= state[0];
+						s1 ^= state[1];
+						s2 ^= state[2];
+						s3 ^= state[3];
+					}
+					Next();
+				}
+			}
+			state[0] = s0;
+			state[1] = s1;
+			state[2] = s2;
+			state[3] = s3;
+		}
+
+		std::uint64_t state[4];
+
+	};
+}
@@ -6,6 +6,7 @@
 
 #include <vector>
 #include <string>
+#include <stdexcept>
 
 #include <xlnt/xlnt.hpp>
 
@@ -17,6 +18,16 @@ namespace CWTeams
 	{
 	public:
 		static void ParsePlayers(const std::string& cwFile, std::vector<CWPlayer>& result)
+		{
+			std::string error;
+			if (!TryParsePlayers(cwFile, result, error))
+			{
+				CW_FATAL(error);
+			}
+		}
+
+		//Like ParsePlayers but returns false with the reason in error instead of exiting when the workbook can't be read
+		static bool TryParsePlayers(const std::string& cwFile, std::vector<CWPlayer>& result, std::string& error)
 		{
 			result.clear();
 			try
@@ -56,9 +67,10 @@ namespace CWTeams
 			}
 			catch (std::exception& e)
 			{
-				CW_FATAL("Unexpected exception: {}", e.what());
+				error = "Failed to read players from \"" + cwFile + "\": " + e.what();
+				return false;
 			}
-
+			return true;
 		}
 
 		static std::pair<std::string, std::string> ParseNames(const std::string& rawName)
@@ -66,7 +78,7 @@ namespace CWTeams
 			std::size_t space = rawName.find(' ');
 			if (space == std::string::npos)
 			{
-				CW_FATAL("Failed to find space in the name of player: {}", rawName);
+				throw std::runtime_error("Failed to find space in the name of player: " + rawName);
 			}
 			return { std::string(rawName, 0, space), std::string(rawName, space + 1) };
 		}
@@ -0,0 +1,346 @@
+#include "Rebalance.h"
+#include "TeamBalancer.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cmath>
+
+namespace CWTeams
+{
+
+	struct Rebalance::Search
+	{
+		GenData& Data;
+		int PlayerCount, TeamCount;
+		//Players from this index onwards just joined and are placed for free, everyone before it costs a move
+		int JoinStart;
+
+		std::vector<double> Ratings;
+		double MinSum, MaxSum;
+		//Every size the match needs, largest first. Which team ends up with which size doesn't matter
+		std::vector<int> TargetSizes;
+
+		std::vector<int> OriginalTeam, TeamOf, Counts;
+		std::vector<double> Sums;
+		std::vector<int> SortedCounts;
+
+		int Limit = 0;
+		long Nodes = 0;
+
+		bool Found = false;
+		std::vector<int> BestTeamOf;
+		TeamSizes BestSizes;
+		TeamResult Best;
+
+		Search(GenData& data) : Data(data) {}
+	};
+
+	std::vector<std::string> Rebalance::SplitList(const std::string& list)
+	{
+		std::vector<std::string> result;
+		std::stringstream ss(list);
+		std::string username;
+		while (std::getline(ss, username, ','))
+		{
+			if (!username.empty()) result.push_back(username);
+		}
+		return result;
+	}
+
+	bool Rebalance::ReadTeams(const std::string& teamsFile, std::vector<std::vector<std::string>>& teams)
+	{
+		std::ifstream file(teamsFile);
+		if (!file) return false;
+
+		std::string line;
+		while (std::getline(file, line))
+		{
+			if (line.empty() || line[0] == '#') continue;
+			std::replace(line.begin(), line.end(), ',', ' ');
+			std::stringstream ss(line);
+			std::vector<std::string> team;
+			std::string username;
+			while (ss >> username)
+			{
+				team.push_back(username);
+			}
+			if (!team.empty()) teams.push_back(team);
+		}
+		return true;
+	}
+
+	bool Rebalance::Run(const GenParameters& defaults, const std::string& teamsFile, const std::vector<std::string>& joins,
+		const std::vector<std::string>& drops, int maxMoves)
+	{
+		std::vector<std::vector<std::string>> teams;
+		if (!ReadTeams(teamsFile, teams))
+		{
+			CW_ERROR("Failed to read the current teams from \"{}\"", teamsFile);
+			return false;
+		}
+		if (teams.size() < 2)
+		{
+			CW_ERROR("Expected at least 2 teams in \"{}\" but found {}", teamsFile, teams.size());
+			return false;
+		}
+
+		auto findPlayer = [&defaults](const std::string& username)
+		{
+			for (int i = 0; i < defaults.Players.size(); i++)
+			{
+				if (IEquals(defaults.Players[i].Username, username)) return i;
+			}
+			CW_ERROR("Failed to find player \"{}\" in the roster", username);
+			return -1;
+		};
+		auto isListed = [](const std::vector<std::string>& usernames, const std::string& username)
+		{
+			for (const auto& other : usernames)
+			{
+				if (IEquals(other, username)) return true;
+			}
+			return false;
+		};
+
+		//The players still in the match, grouped by their current team, followed by everyone who just joined
+		GenParameters params = defaults;
+		params.Players.clear();
+		params.TeamCount = static_cast<int>(teams.size());
+		std::vector<int> originalTeam;
+		std::vector<bool> seen(defaults.Players.size(), false);
+		int dropped = 0;
+		for (int t = 0; t < teams.size(); t++)
+		{
+			for (const auto& username : teams[t])
+			{
+				int index = findPlayer(username);
+				if (index < 0) return false;
+				if (seen[index])
+				{
+					CW_ERROR("Player \"{}\" is on more than one team", username);
+					return false;
+				}
+				seen[index] = true;
+				if (isListed(drops, username))
+				{
+					dropped++;
+					continue;
+				}
+				params.Players.push_back(defaults.Players[index]);
+				originalTeam.push_back(t);
+			}
+		}
+		if (dropped != drops.size())
+		{
+			CW_ERROR("Every dropped player must be on one of the current teams");
+			return false;
+		}
+		const int joinStart = static_cast<int>(params.Players.size());
+		for (const auto& username : joins)
+		{
+			int index = findPlayer(username);
+			if (index < 0) return false;
+			if (seen[index])
+			{
+				CW_ERROR("Player \"{}\" is already playing", username);
+				return false;
+			}
+			seen[index] = true;
+			params.Players.push_back(defaults.Players[index]);
+			originalTeam.push_back(-1);
+		}
+		//Catches what Setup would otherwise exit on, like a team count without weights. Rebalancing never runs a search engine
+		params.Engine = "auto";
+		params.SizeSlack = 0;
+		std::string error;
+		if (!TeamBalancer::Validate(params, error))
+		{
+			CW_ERROR("Can't rebalance into {} teams: {}", teams.size(), error);
+			return false;
+		}
+
+		GenData data { params.Players, params.Restrictions, params.Output };
+		GenerateTeams::Setup(params, data);
+
+		Search search(data);
+		search.PlayerCount = static_cast<int>(params.Players.size());
+		search.TeamCount = params.TeamCount;
+		search.JoinStart = joinStart;
+		search.OriginalTeam = originalTeam;
+		search.TeamOf = originalTeam;
+		search.TargetSizes.assign(data.Sizes.begin(), data.Sizes.end());
+		std::sort(search.TargetSizes.rbegin(), search.TargetSizes.rend());
+
+		//Same bounds as the exhaustive engine. In fixed point mode the sums are exact
+		search.Ratings.resize(search.PlayerCount);
+		for (int i = 0; i < search.PlayerCount; i++)
+		{
+			search.Ratings[i] = data.UseFixedPoint ? static_cast<double>(data.FixedRatings[i]) : data.Ratings[i];
+		}
+		if (data.UseFixedPoint)
+		{
+			search.MinSum = static_cast<double>(data.MinFixedTeamStrength);
+			search.MaxSum = static_cast<double>(data.MaxFixedTeamStrength);
+		}
+		else
+		{
+			const double epsilon = 1e-9 * std::max(1.0, std::abs(data.NeededTeamAverage));
+			search.MinSum = data.NeededTeamAverage - data.MaxTeamDev - epsilon;
+			search.MaxSum = data.NeededTeamAverage + data.MaxTeamDev + epsilon;
+		}
+
+		search.Counts.assign(search.TeamCount, 0);
+		search.Sums.assign(search.TeamCount, 0.0);
+		for (int i = 0; i < joinStart; i++)
+		{
+			search.Counts[search.TeamOf[i]]++;
+			search.Sums[search.TeamOf[i]] += search.Ratings[i];
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		for (search.Limit = 0; search.Limit <= maxMoves && !search.Found; search.Limit++)
+		{
+			PlaceJoins(search, joinStart);
+		}
+		double milliseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+
+		if (!search.Found)
+		{
+			CW_ERROR("No way to rebalance the teams with at most {} moves was found after {} ms. Raise --max-moves or generate new teams", maxMoves, milliseconds);
+			return false;
+		}
+
+		//The moves are only part of the text output. Other formats just get the new team set
+		const bool printMoves = params.Format == OutputFormat::Text && params.Output;
+		int moves = 0;
+		for (int i = 0; i < search.PlayerCount; i++)
+		{
+			const CWPlayer& player = params.Players[i];
+			int team = search.BestTeamOf[i];
+			if (i >= joinStart)
+			{
+				if (printMoves) data.Writer->WriteLine(fmt::format("Add {} ({}) to team #{}", player.RealName, player.Username, team));
+			}
+			else if (team != search.OriginalTeam[i])
+			{
+				if (printMoves) data.Writer->WriteLine(fmt::format("Move {} ({}) from team #{} to team #{}", player.RealName, player.Username, search.OriginalTeam[i], team));
+				moves++;
+			}
+		}
+		data.Sizes = search.BestSizes;
+		GenerateTeams::PrintTeam(data, search.Best, 1);
+		data.Writer->Flush();
+
+		CW_SUCCESS("Rebalanced with {} moves in {} ms after trying {} moves", moves, milliseconds, search.Nodes);
+		return true;
+	}
+
+	void Rebalance::PlaceJoins(Search& search, int join)
+	{
+		if (join == search.PlayerCount)
+		{
+			int bound = GetMovesBound(search);
+			if (search.Limit == 0)
+			{
+				if (bound == 0) Record(search);
+			}
+			else if (bound <= search.Limit)
+			{
+				Move(search, 0, 0);
+			}
+			return;
+		}
+		for (int t = 0; t < search.TeamCount; t++)
+		{
+			search.TeamOf[join] = t;
+			search.Counts[t]++;
+			search.Sums[t] += search.Ratings[join];
+			PlaceJoins(search, join + 1);
+			search.Counts[t]--;
+			search.Sums[t] -= search.Ratings[join];
+		}
+		search.TeamOf[join] = -1;
+	}
+
+	//Every player moves at most once and players are moved in index order, so each set of moves is only tried once
+	void Rebalance::Move(Search& search, int player, int moves)
+	{
+		for (int p = player; p < search.JoinStart; p++)
+		{
+			const int from = search.TeamOf[p];
+			const double rating = search.Ratings[p];
+			for (int to = 0; to < search.TeamCount; to++)
+			{
+				if (to == from) continue;
+				search.Nodes++;
+
+				search.TeamOf[p] = to;
+				search.Counts[from]--;
+				search.Counts[to]++;
+				search.Sums[from] -= rating;
+				search.Sums[to] += rating;
+
+				int bound = GetMovesBound(search);
+				if (bound == 0) Record(search);
+				if (moves + 1 + bound <= search.Limit && moves + 1 < search.Limit) Move(search, p + 1, moves + 1);
+
+				search.TeamOf[p] = from;
+				search.Counts[from]++;
+				search.Counts[to]--;
+				search.Sums[from] += rating;
+				search.Sums[to] -= rating;
+			}
+		}
+	}
+
+	//A lower bound on how many more moves are needed. A move changes the size of one team by -1 and another by +1,
+	//and it can bring at most two teams back into range
+	int Rebalance::GetMovesBound(Search& search)
+	{
+		std::vector<int>& sorted = search.SortedCounts;
+		sorted = search.Counts;
+		std::sort(sorted.rbegin(), sorted.rend());
+		int sizeMoves = 0;
+		for (int t = 0; t < search.TeamCount; t++)
+		{
+			sizeMoves += std::max(0, sorted[t] - search.TargetSizes[t]);
+		}
+
+		int outOfRange = 0;
+		for (double sum : search.Sums)
+		{
+			if (sum < search.MinSum || sum > search.MaxSum) outOfRange++;
+		}
+		return std::max(sizeMoves, (outOfRange + 1) / 2);
+	}
+
+	//Lays the current assignment out the way GenData expects and keeps it if it is valid and better than what was found so far
+	void Rebalance::Record(Search& search)
+	{
+		GenData& data = search.Data;
+		data.Sizes.assign(search.Counts.begin(), search.Counts.end());
+		int offset = 0;
+		std::vector<int> teamOffsets(search.TeamCount);
+		for (int t = 0; t < search.TeamCount; t++)
+		{
+			teamOffsets[t] = offset;
+			offset += search.Counts[t];
+		}
+		for (int i = 0; i < search.PlayerCount; i++)
+		{
+			data.Teams[teamOffsets[search.TeamOf[i]]++] = i;
+		}
+
+		if (!GenerateTeams::AreTeamsValid(data)) return;
+
+		TeamResult result = GenerateTeams::MakeResult(data);
+		if (!search.Found || GenerateTeams::GetScore(data, result) < GenerateTeams::GetScore(data, search.Best))
+		{
+			search.Found = true;
+			search.Best = std::move(result);
+			search.BestTeamOf = search.TeamOf;
+			search.BestSizes = data.Sizes;
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include "GenerateTeams.h"
+
+namespace CWTeams
+{
+
+	//Fixes up teams that were already announced after players join or drop out, moving as few players as possible.
+	//Tries every combination of 0 moves, then 1 move, and so on, keeping each team's strength as a running sum so a move costs O(1)
+	class Rebalance
+	{
+	public:
+		//teamsFile lists the current teams one per line as usernames. Returns false if the teams, joins or drops are invalid
+		//or no fix within maxMoves was found
+		static bool Run(const GenParameters& defaults, const std::string& teamsFile, const std::vector<std::string>& joins,
+			const std::vector<std::string>& drops, int maxMoves);
+
+		//Splits a comma separated list of usernames like the one given to --join
+		static std::vector<std::string> SplitList(const std::string& list);
+
+	private:
+		struct Search;
+
+		static bool ReadTeams(const std::string& teamsFile, std::vector<std::vector<std::string>>& teams);
+		static void PlaceJoins(Search& search, int join);
+		static void Move(Search& search, int player, int moves);
+		static void Record(Search& search);
+		static int GetMovesBound(Search& search);
+
+	};
+}
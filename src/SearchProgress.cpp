@@ -0,0 +1,117 @@
+#include "SearchProgress.h"
+
+#include <cmath>
+#include <csignal>
+#include <limits>
+#include <string>
+#include <iterator>
+#include <spdlog/fmt/fmt.h>
+
+namespace CWTeams
+{
+
+	std::atomic<SearchProgress*> SearchProgress::s_Current { nullptr };
+
+	SearchProgress::SearchProgress() : bestDelta(std::numeric_limits<double>::quiet_NaN())
+	{
+		start = lastPrint = std::chrono::steady_clock::now();
+	}
+
+	SearchProgress::~SearchProgress()
+	{
+		if (s_Current.load() == this) CatchSignals(nullptr);
+		if (thread.joinable())
+		{
+			{
+				std::lock_guard<std::mutex> guard(lock);
+				finished = true;
+			}
+			wake.notify_one();
+			thread.join();
+		}
+	}
+
+	void SearchProgress::Found(double delta)
+	{
+		Valid.fetch_add(1, std::memory_order_relaxed);
+		double best = bestDelta.load(std::memory_order_relaxed);
+		while ((std::isnan(best) || delta < best) && !bestDelta.compare_exchange_weak(best, delta, std::memory_order_relaxed)) {}
+	}
+
+	void SearchProgress::Start(double interval, FILE* file)
+	{
+		this->file = file;
+		this->interval = std::chrono::duration<double>(interval);
+		start = lastPrint = std::chrono::steady_clock::now();
+		thread = std::thread(&SearchProgress::Run, this);
+	}
+
+	void SearchProgress::Finish()
+	{
+		if (!thread.joinable()) return;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			finished = true;
+		}
+		wake.notify_one();
+		thread.join();
+		Print(true);
+	}
+
+	void SearchProgress::Run()
+	{
+		std::unique_lock<std::mutex> guard(lock);
+		while (!wake.wait_for(guard, interval, [this]() { return finished; }))
+		{
+			Print(false);
+		}
+	}
+
+	void SearchProgress::Print(bool done)
+	{
+		auto now = std::chrono::steady_clock::now();
+		const double elapsed = std::chrono::duration<double>(now - start).count();
+		const double sinceLast = std::max(1e-9, std::chrono::duration<double>(now - lastPrint).count());
+		const long candidates = Candidates.load(std::memory_order_relaxed);
+		const long valid = Valid.load(std::memory_order_relaxed);
+		const long draws = Draws.load(std::memory_order_relaxed);
+		const double best = bestDelta.load(std::memory_order_relaxed);
+
+		//Rates are over the last interval so a search that slows down as it runs out of new team sets shows up
+		std::string line;
+		auto out = std::back_inserter(line);
+		fmt::format_to(out, "{{\"elapsed\":{:.3f},\"candidates\":{},\"candidates_per_second\":{:.1f},\"valid\":{},\"valid_per_second\":{:.1f}",
+			elapsed, candidates, (candidates - lastCandidates) / sinceLast, valid, (valid - lastValid) / sinceLast);
+		//Only the sampler draws the same team set more than once
+		if (draws > 0) fmt::format_to(out, ",\"dedupe_hit_rate\":{:.4f}", static_cast<double>(draws - valid) / draws);
+		else line += ",\"dedupe_hit_rate\":null";
+		if (std::isnan(best)) line += ",\"best_delta\":null";
+		else fmt::format_to(out, ",\"best_delta\":{}", best);
+		fmt::format_to(out, ",\"stopping\":{},\"done\":{}}}\n", ShouldStop(), done);
+
+		fputs(line.c_str(), file);
+		fflush(file);
+		lastPrint = now;
+		lastCandidates = candidates;
+		lastValid = valid;
+	}
+
+	void SearchProgress::CatchSignals(SearchProgress* progress)
+	{
+		s_Current.store(progress);
+		std::signal(SIGINT, progress ? &SearchProgress::OnSignal : SIG_DFL);
+		std::signal(SIGTERM, progress ? &SearchProgress::OnSignal : SIG_DFL);
+	}
+
+	void SearchProgress::OnSignal(int signal)
+	{
+		//Only lock free atomics and signal() are safe in here
+		SearchProgress* progress = s_Current.load();
+		if (progress)
+		{
+			progress->signal.store(signal);
+			progress->RequestStop();
+		}
+		std::signal(signal, SIG_DFL);
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <stdio.h>
+
+namespace CWTeams
+{
+
+	//Shared between the running searches and whoever is watching them. The engines only ever do relaxed adds, so every scenario of a batch or sweep
+	//can report to the same one, and a background thread turns them into a JSON progress line every few seconds, so the search loops never look at the clock for it
+	class SearchProgress
+	{
+	public:
+		SearchProgress();
+		~SearchProgress();
+
+		SearchProgress(const SearchProgress& other) = delete;
+		SearchProgress& operator=(const SearchProgress& other) = delete;
+
+		//Team sets looked at, whether or not they were valid
+		std::atomic<long> Candidates { 0 };
+		//Valid team sets drawn by the sampler, including ones it had already found
+		std::atomic<long> Draws { 0 };
+		//Distinct valid team sets
+		std::atomic<long> Valid { 0 };
+
+		//Call for every new valid team set
+		void Found(double delta);
+
+		bool ShouldStop() const { return stop.load(std::memory_order_relaxed); }
+		void RequestStop() { stop.store(true, std::memory_order_relaxed); }
+		//The signal that stopped the search, or 0
+		int GetSignal() const { return signal.load(); }
+
+		//Prints a progress line to file every interval seconds until Finish
+		void Start(double interval, FILE* file);
+		//Prints the last progress line and stops the timer thread
+		void Finish();
+
+		//Makes SIGINT and SIGTERM stop progress' search instead of killing the process, until this is called with null.
+		//A second signal kills the process as usual
+		static void CatchSignals(SearchProgress* progress);
+
+	private:
+		void Run();
+		void Print(bool done);
+
+		std::atomic<bool> stop { false };
+		std::atomic<int> signal { 0 };
+		std::atomic<double> bestDelta;
+
+		FILE* file = nullptr;
+		std::chrono::duration<double> interval;
+		std::chrono::steady_clock::time_point start, lastPrint;
+		long lastCandidates = 0, lastValid = 0;
+
+		std::mutex lock;
+		std::condition_variable wake;
+		bool finished = false;
+		std::thread thread;
+
+		static void OnSignal(int signal);
+		static std::atomic<SearchProgress*> s_Current;
+
+	};
+}
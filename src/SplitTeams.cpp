@@ -0,0 +1,287 @@
+#include "SplitTeams.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace CWTeams
+{
+
+	//How many candidates go by between updates of the shared progress
+	static const long PROGRESS_BATCH = 4096;
+	//The first band of the outward walk is this fraction of the whole window, and every band after it this many times wider.
+	//With dozens of players even a thousandth of the window holds billions of splits, so it starts out very narrow
+	static const double FIRST_BAND_DIVISOR = 1 << 30;
+	static const double BAND_GROWTH = 4.0;
+
+	void SplitTeams::KeepBest(GenData& data, int limit)
+	{
+		//data.Results is a heap with the worst kept split on top, so a split that doesn't beat it is dropped without being copied
+		auto worse = [&data](const TeamResult& a, const TeamResult& b) { return GenerateTeams::GetScore(data, a) < GenerateTeams::GetScore(data, b); };
+		auto range = std::minmax_element(data.TeamStrengths.begin(), data.TeamStrengths.end());
+		const double delta = *range.second - *range.first;
+		if (data.Progress) data.Progress->Found(delta);
+
+		if (static_cast<int>(data.Results.size()) < limit)
+		{
+			data.Results.push_back(GenerateTeams::MakeResult(data));
+			std::push_heap(data.Results.begin(), data.Results.end(), worse);
+			return;
+		}
+		if (delta + data.HistoryWeight * data.RepeatPenalty >= GenerateTeams::GetScore(data, data.Results.front())) return;
+		std::pop_heap(data.Results.begin(), data.Results.end(), worse);
+		data.Results.back() = GenerateTeams::MakeResult(data);
+		std::push_heap(data.Results.begin(), data.Results.end(), worse);
+	}
+
+	double SplitTeams::GetWorstReach(const GenData& data, bool fixed, double epsilon)
+	{
+		return GenerateTeams::GetScore(data, data.Results.front()) * (fixed ? data.FixedScale : 1) / 2.0 + epsilon;
+	}
+
+	std::vector<std::vector<SplitTeams::SubsetSum>> SplitTeams::GetSubsetSums(const std::vector<double>& ratings, bool requireFirst)
+	{
+		const std::uint32_t count = 1u << ratings.size();
+		std::vector<double> sums(count, 0.0);
+		std::vector<std::vector<SubsetSum>> result(ratings.size() + 1);
+		for (std::uint32_t mask = 0; mask < count; mask++)
+		{
+			if (mask != 0)
+			{
+				//Every subset is a smaller subset plus its lowest player
+				int lowest = 0;
+				while (!(mask & (1u << lowest))) lowest++;
+				sums[mask] = sums[mask & (mask - 1)] + ratings[lowest];
+			}
+			if (requireFirst && !(mask & 1u)) continue;
+
+			int size = 0;
+			for (std::uint32_t bits = mask; bits; bits &= bits - 1) size++;
+			result[size].push_back({ sums[mask], mask });
+		}
+		for (auto& sizeGroup : result)
+		{
+			std::sort(sizeGroup.begin(), sizeGroup.end());
+		}
+		return result;
+	}
+
+	GenSummary SplitTeams::Gen(GenParameters& params)
+	{
+		if (params.Profile) params.Profile->Begin("setup");
+		GenData data { params.Players, params.Restrictions, params.Output };
+		GenerateTeams::Setup(params, data);
+		if (data.Sizes.size() != 2)
+		{
+			CW_FATAL("The split engine only works for 2 teams but {} were requested", data.Sizes.size());
+		}
+
+		const int playerCount = static_cast<int>(data.Players.size());
+		if (playerCount > MAX_PLAYERS)
+		{
+			CW_FATAL("The split engine supports at most {} players but got {}", MAX_PLAYERS, playerCount);
+		}
+
+		if (params.Profile) params.Profile->Begin("subset sums");
+		auto start = std::chrono::steady_clock::now();
+
+		//In fixed point mode the ratings are whole numbers, so every subset sum and the window below are exact
+		const bool fixed = data.UseFixedPoint;
+		std::vector<double> ratings;
+		double total = 0.0;
+		for (int i = 0; i < playerCount; i++)
+		{
+			ratings.push_back(fixed ? static_cast<double>(data.FixedRatings[i]) : data.Ratings[i]);
+			total += ratings.back();
+		}
+
+		//The first team must be in range and so must everyone else, which is the second team
+		double minSum, maxSum;
+		const double rounding = 1e-9 * std::max(1.0, std::abs(total));
+		const double epsilon = fixed ? 1.0 : rounding;
+		if (fixed)
+		{
+			minSum = static_cast<double>(std::max(data.MinFixedTeamStrength, static_cast<FixedRating>(total) - data.MaxFixedTeamStrength));
+			maxSum = static_cast<double>(std::min(data.MaxFixedTeamStrength, static_cast<FixedRating>(total) - data.MinFixedTeamStrength));
+		}
+		else
+		{
+			minSum = std::max(data.NeededTeamAverage - data.MaxTeamDev, total - data.NeededTeamAverage - data.MaxTeamDev) - epsilon;
+			maxSum = std::min(data.NeededTeamAverage + data.MaxTeamDev, total - data.NeededTeamAverage + data.MaxTeamDev) + epsilon;
+		}
+
+		const int half = playerCount / 2;
+		const int firstSize = data.Sizes[0];
+		//With equal sizes each split would show up twice, once with the teams swapped. Keep the one with player #0 on the first team
+		const bool requireFirst = data.Sizes[0] == data.Sizes[1] && half > 0;
+
+		std::vector<double> lowerRatings(ratings.begin(), ratings.begin() + half);
+		std::vector<double> upperRatings(ratings.begin() + half, ratings.end());
+		auto lowerSums = GetSubsetSums(lowerRatings, requireFirst);
+		auto upperSums = GetSubsetSums(upperRatings, false);
+		CW_INFO("Listed {} + {} subset sums in {} ms", std::size_t(1) << lowerRatings.size(), std::size_t(1) << upperRatings.size(),
+			std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+
+		if (params.Profile) params.Profile->Begin("search");
+		//Sorted output keeps the best splits out of all of them instead of the first ones found, which only depend on the player order.
+		//The Pareto front and diverse selection pick from what was kept, so they still stop at the output limit
+		const bool keepBest = params.Sort && !data.Archive && data.DiverseCount == 0 && params.LimitOutput > 0;
+		const long timeout = params.TimeoutSeconds * 1000L;
+		long candidates = 0, reportedCandidates = 0;
+		int validOptions = 0;
+		bool limited = false, timedOut = false, narrowed = false, settled = false;
+		//Once the output is full, how far out a first team can be and still have a smaller delta than the worst kept split
+		double cutoff = std::numeric_limits<double>::infinity();
+
+		//A split's delta is twice how far its first team is from half the total, and its score is at least that. The splits are walked in bands
+		//of that distance, closest first and each band wider than the last, so the first ones found are the most balanced. Once the kept splits
+		//score better than anything past the current band could, the rest are never looked at
+		const double center = total / 2.0;
+		//In fixed point every first team sums to a whole number, so none can be closer to the center than this
+		const double closest = fixed ? std::abs(center - std::round(center)) : 0.0;
+		double inner = -1.0, reach = std::max({ std::max(maxSum - center, center - minSum) / FIRST_BAND_DIVISOR, fixed ? 0.5 : rounding });
+		for (bool last = false; !last && !limited && !settled; inner = reach, reach *= BAND_GROWTH)
+		{
+			last = reach >= std::max(maxSum - center, center - minSum);
+			//Rounding can put a sum a hair past the window, so the last band takes everything left
+			if (last) reach = std::numeric_limits<double>::infinity();
+
+			for (int lowerCount = 0; lowerCount <= half && !limited && !settled; lowerCount++)
+			{
+				int upperCount = firstSize - lowerCount;
+				if (upperCount < 0 || upperCount > static_cast<int>(upperRatings.size())) continue;
+
+				const auto& lower = lowerSums[lowerCount];
+				const auto& upper = upperSums[upperCount];
+
+				//Walk the lower sums from largest to smallest so the matching window of upper sums only ever moves up
+				std::size_t windowStart = 0, windowEnd = 0;
+				for (auto it = lower.rbegin(); it != lower.rend() && !limited && !settled; ++it)
+				{
+					if (candidates - reportedCandidates >= PROGRESS_BATCH)
+					{
+						if (data.Progress) data.Progress->Candidates.fetch_add(candidates - reportedCandidates, std::memory_order_relaxed);
+						reportedCandidates = candidates;
+						if (data.Progress && data.Progress->ShouldStop())
+						{
+							limited = true;
+							break;
+						}
+						//Going through every split can take much longer than stopping at the output limit did
+						if (keepBest && std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() > timeout)
+						{
+							timedOut = limited = true;
+							break;
+						}
+					}
+					//The band's window, widened a little since the bands themselves are told apart by the summed first team below
+					const double low = std::max(minSum, center - reach - epsilon), high = std::min(maxSum, center + reach + epsilon);
+					while (windowStart < upper.size() && upper[windowStart].Sum < low - it->Sum) windowStart++;
+					if (windowEnd < windowStart) windowEnd = windowStart;
+					while (windowEnd < upper.size() && upper[windowEnd].Sum <= high - it->Sum) windowEnd++;
+					//The window may have shrunk since the last lower sum
+					while (windowEnd > windowStart && upper[windowEnd - 1].Sum > high - it->Sum) windowEnd--;
+
+					for (std::size_t j = windowStart; j < windowEnd; j++)
+					{
+						if (upper[j].Sum > maxSum - it->Sum) break;
+						//Splits closer to the center were checked in an earlier band
+						const double distance = std::abs(it->Sum + upper[j].Sum - center);
+						if (distance <= inner || distance > reach) continue;
+						//Ties with the worst kept split can't replace it, and there can be millions of them
+						if (distance >= cutoff) continue;
+						candidates++;
+						std::uint64_t firstTeam = static_cast<std::uint64_t>(it->Mask) | (static_cast<std::uint64_t>(upper[j].Mask) << half);
+						int first = 0, second = firstSize;
+						for (int player = 0; player < playerCount; player++)
+						{
+							if (firstTeam & (std::uint64_t(1) << player)) data.Teams[first++] = player;
+							else data.Teams[second++] = player;
+						}
+
+						//The window is exact up to rounding, so let the normal validation have the final say
+						if (!GenerateTeams::AreTeamsValid(data)) continue;
+
+						validOptions++;
+						if (keepBest)
+						{
+							KeepBest(data, params.LimitOutput);
+							//Once the output is full only first teams closer to half than the worst kept score can still get in
+							if (static_cast<int>(data.Results.size()) == params.LimitOutput)
+							{
+								const double worstReach = GetWorstReach(data, fixed, epsilon);
+								//Everything left is at least as far out as the last band went, so none of it can beat the worst kept split
+								if (worstReach - epsilon <= std::max(inner, closest) + rounding)
+								{
+									settled = true;
+									break;
+								}
+								cutoff = worstReach - epsilon - rounding;
+								minSum = std::max(minSum, center - worstReach);
+								maxSum = std::min(maxSum, center + worstReach);
+								narrowed = true;
+							}
+							continue;
+						}
+						if (params.Sort)
+						{
+							GenerateTeams::Keep(data, data.Results);
+						}
+						else
+						{
+							GenerateTeams::Print(data, validOptions);
+						}
+						if (validOptions >= params.LimitOutput)
+						{
+							limited = true;
+							break;
+						}
+					}
+				}
+			}
+
+			//Every split further out than this band has a larger delta than the worst one kept
+			if (!last && !limited && keepBest && static_cast<int>(data.Results.size()) == params.LimitOutput && GetWorstReach(data, fixed, epsilon) - epsilon <= reach + rounding)
+			{
+				settled = true;
+			}
+		}
+
+		if (data.Progress) data.Progress->Candidates.fetch_add(candidates - reportedCandidates, std::memory_order_relaxed);
+
+		double seconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count() / 1000000.0;
+		if (params.Profile) params.Profile->Begin("output");
+		//Splits outside the narrowed window or past the last band were never counted
+		const bool complete = !limited && !narrowed && !settled;
+		GenSummary summary = GenerateTeams::Summarize(data, validOptions, complete, complete);
+		if (params.PrintTeams) GenerateTeams::PrintResults(data);
+		if (params.Profile)
+		{
+			params.Profile->End();
+			params.Profile->SetWork(candidates, "split");
+		}
+		if (params.Progress && params.Progress->ShouldStop())
+		{
+			CW_WARN("Interrupted after {} valid splits ({} seconds)", validOptions, seconds);
+		}
+		else if (timedOut)
+		{
+			CW_WARN("Stopped after {} seconds, keeping the best {} of the {} valid splits found so far", timeout / 1000, data.Results.size(), validOptions);
+		}
+		else if (limited)
+		{
+			CW_SUCCESS("Stopped after {} valid splits because of the output limit ({} seconds)", validOptions, seconds);
+		}
+		else if (narrowed || settled)
+		{
+			CW_SUCCESS("Kept the best {} splits out of the {} valid ones that could still beat them ({} seconds)", data.Results.size(), validOptions, seconds);
+		}
+		else
+		{
+			CW_SUCCESS("Found all {} valid splits in {} seconds", validOptions, seconds);
+		}
+		CW_SUCCESS("Checked {} splits inside the strength window", candidates);
+		return summary;
+	}
+
+}
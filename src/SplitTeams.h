@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "GenerateTeams.h"
+
+namespace CWTeams
+{
+
+	//Finds the balanced two team splits with a meet-in-the-middle subset sum search, the most balanced first.
+	//Runs in O(2^(n/2)) so it handles player pools that are far too big for the sampler
+	class SplitTeams
+	{
+	public:
+		static GenSummary Gen(GenParameters& params);
+
+		//Every subset of each half of the players is listed, which stops fitting in memory past 26 players a half
+		static constexpr int MAX_PLAYERS = 52;
+		//The most players the auto engine picks this engine for. The subset tables take 32 MiB here but 2 GiB at MAX_PLAYERS
+		static constexpr int AUTO_MAX_PLAYERS = 40;
+
+	private:
+		struct SubsetSum
+		{
+			double Sum;
+			std::uint32_t Mask;
+
+			bool operator<(const SubsetSum& other) const { return Sum < other.Sum; }
+		};
+
+		//Keeps the valid split in data if it is among the limit best found so far
+		static void KeepBest(GenData& data, int limit);
+		//How far from half the total a first team can be and still beat the worst kept split, in the units of the subset sums
+		static double GetWorstReach(const GenData& data, bool fixed, double epsilon);
+
+		//Lists the sum of every subset of ratings, grouped by subset size and sorted by sum
+		static std::vector<std::vector<SubsetSum>> GetSubsetSums(const std::vector<double>& ratings, bool requireFirst);
+
+	};
+}
@@ -0,0 +1,159 @@
+#include "TeamBalancer.h"
+#include "MixedSizes.h"
+#include "SplitTeams.h"
+
+#include <algorithm>
+
+namespace CWTeams
+{
+
+	bool TeamBalancer::Validate(const GenParameters& params, std::string& error)
+	{
+		const int playerCount = static_cast<int>(params.Players.size());
+		//Team sets store player indices as bytes
+		if (playerCount > 255)
+		{
+			error = "At most 255 players are supported";
+			return false;
+		}
+		if (params.TeamCount < 1 || params.TeamCount > playerCount)
+		{
+			error = "Can't split " + std::to_string(playerCount) + " players into " + std::to_string(params.TeamCount) + " teams";
+			return false;
+		}
+		if (params.Precision < 0 || params.Precision > 9)
+		{
+			error = "Precision must be between 0 and 9 decimal places";
+			return false;
+		}
+		if (!params.Sizes.empty())
+		{
+			int total = 0;
+			for (auto size : params.Sizes) total += size;
+			if (params.Sizes.size() != params.TeamCount || total != playerCount
+				|| *std::min_element(params.Sizes.begin(), params.Sizes.end()) == 0)
+			{
+				error = "The team sizes must be one non empty team for each of the " + std::to_string(params.TeamCount) + " teams, adding up to the "
+					+ std::to_string(playerCount) + " players";
+				return false;
+			}
+		}
+		const TeamSizes sizes = params.Sizes.empty() ? GenerateTeams::GetRoundRobinSizes(playerCount, params.TeamCount) : params.Sizes;
+		if (params.SizeSlack > 0 && params.Sizes.empty())
+		{
+			//Layouts without weights are skipped, but at least one has to be left
+			bool any = false;
+			for (const TeamSizes& layout : MixedSizes::GetLayouts(playerCount, params.TeamCount, params.SizeSlack))
+			{
+				any = any || MixedSizes::HasWeights(params.WeightsMap, layout);
+			}
+			if (!any)
+			{
+				error = "No weights for any way of splitting the players into " + std::to_string(params.TeamCount) + " teams within the size slack";
+				return false;
+			}
+		}
+		else
+		{
+			WeightsData weights;
+			if (!params.WeightsMap.TrySelect(sizes, weights))
+			{
+				error = "No weights for " + std::to_string(params.TeamCount) + " teams";
+				return false;
+			}
+			if (params.PerTeamWeights && !MixedSizes::HasWeights(params.WeightsMap, sizes))
+			{
+				error = "No weights for a team of each size";
+				return false;
+			}
+			if ((params.Pareto || !params.AxisDeviation.empty()) && !GenerateTeams::DoAxesFit(params.Players, weights, params.Precision))
+			{
+				error = "Ratings are too large to balance each axis with " + std::to_string(params.Precision) + " decimal places";
+				return false;
+			}
+		}
+		if (params.CountOnly && (params.Pareto || !params.AxisDeviation.empty()))
+		{
+			error = "Counting only looks at the overall rating, so it can't be combined with per axis balancing";
+			return false;
+		}
+		if (params.Diverse < 0)
+		{
+			error = "The number of diverse team sets can't be negative";
+			return false;
+		}
+		if (params.CountOnly && params.Diverse > 0)
+		{
+			error = "Counting only doesn't keep any team sets to pick diverse ones from";
+			return false;
+		}
+		if (!GenerateTeams::IsKnownEngine(params.Engine))
+		{
+			error = "Unknown engine \"" + params.Engine + "\"";
+			return false;
+		}
+		if (params.Engine == "split" && (params.TeamCount != 2 || playerCount > SplitTeams::MAX_PLAYERS))
+		{
+			error = "The split engine only works for 2 teams of at most " + std::to_string(SplitTeams::MAX_PLAYERS) + " players in total";
+			return false;
+		}
+		if (params.SizeSlack < 0)
+		{
+			error = "The team size slack can't be negative";
+			return false;
+		}
+		if (params.SizeSlack > 0 && (params.Engine == "split" || params.Engine == "exhaustive" || params.CountOnly))
+		{
+			error = "Mixed team sizes are only searched by the sample engine";
+			return false;
+		}
+		if (params.SizeSlack > 0 && (params.Pareto || !params.AxisDeviation.empty() || params.Diverse > 0 || params.Format == OutputFormat::Binary))
+		{
+			error = "Mixed team sizes can't be combined with per axis balancing, diverse team sets or the binary format";
+			return false;
+		}
+		if (params.Format == OutputFormat::Binary)
+		{
+			for (const CWPlayer& player : params.Players)
+			{
+				if (player.Username.size() > OutputWriter::MAX_BINARY_USERNAME)
+				{
+					error = "Username \"" + player.Username + "\" is longer than the " + std::to_string(OutputWriter::MAX_BINARY_USERNAME)
+						+ " bytes the binary format can store";
+					return false;
+				}
+			}
+		}
+		for (const std::string& separation : params.Separations)
+		{
+			std::size_t colon = separation.find(':');
+			if (colon == std::string::npos || separation.find(':', colon + 1) != std::string::npos
+				|| !PlayerRestrictor::ContainsUsername(params.Players, separation.substr(0, colon))
+				|| !PlayerRestrictor::ContainsUsername(params.Players, separation.substr(colon + 1))
+				|| IEquals(separation.substr(0, colon), separation.substr(colon + 1)))
+			{
+				error = "Invalid separation \"" + separation + "\"";
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool TeamBalancer::Balance(GenParameters params, const TeamSetCallback& callback, GenSummary& summary, std::string& error)
+	{
+		if (!Validate(params, error)) return false;
+
+		if (params.Restrictions.empty())
+		{
+			PlayerRestrictor::Restrict(params.Players, params.Separations, params.Restrictions);
+		}
+		params.Output = nullptr;
+		params.PrintTeams = true;
+		params.OnTeamSet = [&callback](const GenData& data, const TeamResult& result, int ordinal)
+		{
+			callback({ data.Players, data.Sizes, result.Teams, result.Strengths, result.Delta, result.Repeats, ordinal });
+		};
+		summary = GenerateTeams::Run(params);
+		return true;
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <functional>
+
+#include "GenerateTeams.h"
+
+namespace CWTeams
+{
+
+	//One valid team set as handed to a TeamBalancer callback. Only valid for the duration of the call
+	struct TeamSetView
+	{
+		const std::vector<CWPlayer>& Players;
+		//How many players are on each team. The first Sizes[0] entries of Teams are team #0 and so on
+		const TeamSizes& Sizes;
+		//Indices into Players
+		const TeamSet& Teams;
+		const std::vector<double>& Strengths;
+		double Delta;
+		//How many past teammates were put together again, 0 without a history
+		long Repeats;
+		int Ordinal;
+	};
+
+	using TeamSetCallback = std::function<void(const TeamSetView&)>;
+
+	//Entry point for programs that embed the generator instead of running it as a process.
+	//Each call works on its own copy of the parameters, so any number of balances can run at once from different threads
+	class TeamBalancer
+	{
+	public:
+		//Fill in Players, WeightsMap (see Weights::Add), TeamCount and the search settings of params, then every valid team set
+		//is handed to callback as it is found (or best last once the search is over when Sort is set).
+		//Returns false and fills in error instead of exiting when params can't be balanced
+		static bool Balance(GenParameters params, const TeamSetCallback& callback, GenSummary& summary, std::string& error);
+
+		//Checks everything that would otherwise end the program with a fatal error
+		static bool Validate(const GenParameters& params, std::string& error);
+
+	};
+}
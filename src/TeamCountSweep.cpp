@@ -0,0 +1,114 @@
+#include "TeamCountSweep.h"
+#include "TeamBalancer.h"
+
+#include <thread>
+#include <atomic>
+#include <sstream>
+#include <cmath>
+
+namespace CWTeams
+{
+
+	bool TeamCountSweep::ParseRange(const std::string& value, int playerCount, int& minTeams, int& maxTeams)
+	{
+		if (value == "auto")
+		{
+			//Every team needs at least 2 players
+			minTeams = 2;
+			maxTeams = std::max(2, playerCount / 2);
+			return true;
+		}
+
+		std::size_t dots = value.find("..");
+		if (dots == std::string::npos) return false;
+		try
+		{
+			minTeams = std::stoi(value.substr(0, dots));
+			maxTeams = std::stoi(value.substr(dots + 2));
+		}
+		catch (std::exception& e)
+		{
+			return false;
+		}
+		return minTeams >= 1 && minTeams <= maxTeams;
+	}
+
+	void TeamCountSweep::Run(const GenParameters& defaults, int minTeams, int maxTeams)
+	{
+		const int playerCount = static_cast<int>(defaults.Players.size());
+		maxTeams = std::min(maxTeams, playerCount);
+
+		struct Entry
+		{
+			int TeamCount;
+			TeamSizes Sizes;
+			GenSummary Summary;
+		};
+		std::vector<Entry> entries;
+		for (int teamCount = minTeams; teamCount <= maxTeams; teamCount++)
+		{
+			GenParameters params = defaults;
+			params.TeamCount = teamCount;
+			std::string error;
+			if (!TeamBalancer::Validate(params, error))
+			{
+				CW_WARN("Skipping {} teams: {}", teamCount, error);
+				continue;
+			}
+			entries.push_back({ teamCount, GenerateTeams::GetRoundRobinSizes(playerCount, teamCount), GenSummary() });
+		}
+		if (entries.empty())
+		{
+			CW_FATAL("None of the team counts from {} to {} can be balanced", minTeams, maxTeams);
+		}
+
+		int threadCount = std::max(1, std::min(defaults.Threads, static_cast<int>(entries.size())));
+		CW_INFO("Sweeping {} team counts from {} to {} using {} threads", entries.size(), entries.front().TeamCount, entries.back().TeamCount, threadCount);
+		auto start = std::chrono::steady_clock::now();
+
+		std::atomic<std::size_t> next { 0 };
+		auto work = [&entries, &next, &defaults, threadCount]()
+		{
+			for (std::size_t i = next++; i < entries.size(); i = next++)
+			{
+				GenParameters params = defaults;
+				params.TeamCount = entries[i].TeamCount;
+				params.Stream = static_cast<int>(i);
+				params.Threads = std::max(1, defaults.Threads / threadCount);
+				//Keep every team set so the best delta can be found, but only the summary gets printed
+				params.Sort = true;
+				params.PrintTeams = false;
+				entries[i].Summary = GenerateTeams::Run(params);
+			}
+		};
+		std::vector<std::thread> threads;
+		for (int i = 1; i < threadCount; i++)
+		{
+			threads.emplace_back(work);
+		}
+		work();
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+
+		double seconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count() / 1000.0;
+		CW_SUCCESS("Swept {} team counts in {} seconds", entries.size(), seconds);
+
+		fprintf(defaults.Output, "\nTEAMS\tMATCH\tBEST-DELTA\tVALID-SETS\n");
+		for (const Entry& entry : entries)
+		{
+			std::stringstream match;
+			for (int i = 0; i < entry.Sizes.size(); i++)
+			{
+				match << (int) entry.Sizes[i];
+				if (i < entry.Sizes.size() - 1) match << "v";
+			}
+			const GenSummary& summary = entry.Summary;
+			std::string best = std::isnan(summary.BestDelta) ? "-" : std::to_string(summary.BestDelta);
+			//Unless the engine counted them exactly there are only known to be at least this many valid sets
+			fprintf(defaults.Output, "%d\t%s\t%s\t%s%ld\n", entry.TeamCount, match.str().c_str(), best.c_str(), summary.Exact ? "" : ">=", summary.ValidSets);
+		}
+	}
+
+}
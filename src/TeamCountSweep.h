@@ -0,0 +1,18 @@
+#pragma once
+
+#include "GenerateTeams.h"
+
+namespace CWTeams
+{
+
+	//Runs the same search for several team counts at once and reports how well balanced each match format can be
+	class TeamCountSweep
+	{
+	public:
+		static void Run(const GenParameters& defaults, int minTeams, int maxTeams);
+
+		//Parses "auto" or a range like "2..5" into the team counts to try. Returns false if value is neither
+		static bool ParseRange(const std::string& value, int playerCount, int& minTeams, int& maxTeams);
+
+	};
+}
@@ -0,0 +1,83 @@
+#include "TeamHistory.h"
+
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <cctype>
+
+namespace CWTeams
+{
+
+	static std::string ToLower(std::string value)
+	{
+		std::transform(value.begin(), value.end(), value.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return value;
+	}
+
+	bool TeamHistory::Load(const std::string& file, TeamHistory& result)
+	{
+		std::ifstream input(file);
+		if (!input) return false;
+
+		result.matches.clear();
+		std::string line;
+		while (std::getline(input, line))
+		{
+			if (line.empty() || line[0] == '#') continue;
+			std::replace(line.begin(), line.end(), ',', ' ');
+
+			std::vector<std::vector<std::string>> match;
+			std::stringstream teams(line);
+			std::string team;
+			while (std::getline(teams, team, '|'))
+			{
+				std::stringstream usernames(team);
+				std::vector<std::string> members;
+				std::string username;
+				while (usernames >> username)
+				{
+					members.push_back(ToLower(username));
+				}
+				if (!members.empty()) match.push_back(members);
+			}
+			if (!match.empty()) result.matches.push_back(match);
+		}
+		return true;
+	}
+
+	void TeamHistory::BuildRepeats(const std::vector<CWPlayer>& players, std::vector<std::uint16_t>& counts) const
+	{
+		const std::size_t playerCount = players.size();
+		counts.assign(playerCount * playerCount, 0);
+
+		std::unordered_map<std::string, int> indices;
+		for (int i = 0; i < playerCount; i++)
+		{
+			indices[ToLower(players[i].Username)] = i;
+		}
+
+		std::vector<int> members;
+		for (const auto& match : matches)
+		{
+			for (const auto& team : match)
+			{
+				members.clear();
+				for (const auto& username : team)
+				{
+					auto it = indices.find(username);
+					if (it != indices.end()) members.push_back(it->second);
+				}
+				for (int a : members)
+				{
+					for (int b : members)
+					{
+						std::uint16_t& count = counts[a * playerCount + b];
+						if (a != b && count < std::numeric_limits<std::uint16_t>::max()) count++;
+					}
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "CWPlayer.h"
+
+namespace CWTeams
+{
+
+	//Past matches, used to steer away from putting the same players together night after night
+	class TeamHistory
+	{
+	public:
+		//Reads one match per line, with teams separated by '|' and usernames by spaces or commas. Returns false if the file can't be read
+		static bool Load(const std::string& file, TeamHistory& result);
+
+		//Fills counts with how many times each pair of players was on the same team, as a players.size() squared matrix.
+		//Players that never played before, and past players that aren't in players, are simply never counted
+		void BuildRepeats(const std::vector<CWPlayer>& players, std::vector<std::uint16_t>& counts) const;
+
+		std::size_t GetMatchCount() const { return matches.size(); }
+
+	private:
+		//Every past match as its teams of lowercase usernames
+		std::vector<std::vector<std::vector<std::string>>> matches;
+
+	};
+}
@@ -5,6 +5,7 @@
 #include <math.h>
 #include <algorithm>
 #include <numeric>
+#include <stdexcept>
 
 #include "ExcelUtils.h"
 
@@ -12,6 +13,27 @@ namespace CWTeams
 {
 
 	WeightsData Weights::Select(const TeamSizes& teamSizes)
+	{
+		const std::string situation = GetSituation(teamSizes);
+		CW_INFO("Searching for situation \"{}\" in the situations pool", situation);
+		WeightsData result;
+		std::string query;
+		bool found = TrySelect(teamSizes, result, query);
+		if (query != situation)
+		{
+			CW_INFO("Failed to find \"{}\". Searching for situation \"{}\" in the situations pool", situation, query);
+		}
+		if (!found)
+		{
+			CW_FATAL("Failed to find situation \"{}\" after 2 attempts. Also tried \"{}\"", query, situation);
+		}
+
+		CW_SUCCESS("Found situation \"{}\" in the situations pool", query);
+		CW_INFO("Applying weights: pvp: {}, gamesense: {}, teamwork: {}", result.PVP, result.Gamesense, result.Teamwork);
+		return result;
+	}
+
+	std::string Weights::GetSituation(const TeamSizes& teamSizes)
 	{
 		std::stringstream ss;
 		for (int i = 0; i < teamSizes.size(); i++)
@@ -22,30 +44,52 @@ namespace CWTeams
 				ss << "v";
 			}
 		}
-		std::string query = ss.str();
-		CW_INFO("Searching for situation \"{}\" in the situations pool", query);
+		return ss.str();
+	}
+
+	bool Weights::TrySelect(const TeamSizes& teamSizes, WeightsData& result) const
+	{
+		std::string query;
+		return TrySelect(teamSizes, result, query);
+	}
+
+	bool Weights::TrySelect(const TeamSizes& teamSizes, WeightsData& result, std::string& query) const
+	{
+		query = GetSituation(teamSizes);
 		auto dataIt = weightsMap.find(query);
 		if (dataIt == weightsMap.end())
 		{
+			//Fall back to the weights for the average team size
 			double average = std::accumulate(teamSizes.begin(), teamSizes.end(), 0.0) / teamSizes.size();
-
-			std::string oldQuery = query;
 			query = std::to_string((int) (std::floor(average + 0.49999))) + "v";
-
-			CW_INFO("Failed to find \"{}\". Searching for situation \"{}\" in the situations pool", oldQuery, query);
 			dataIt = weightsMap.find(query);
 			if (dataIt == weightsMap.end())
 			{
-				CW_FATAL("Failed to find situation \"{}\" after 2 attempts. Also tried \"{}\"", query, oldQuery);
+				return false;
 			}
 		}
+		result = dataIt->second;
+		return true;
+	}
 
-		CW_SUCCESS("Found situation \"{}\" in the situations pool", query);
-		CW_INFO("Applying weights: pvp: {}, gamesense: {}, teamwork: {}", dataIt->second.PVP, dataIt->second.Gamesense, dataIt->second.Teamwork);
-		return dataIt->second;
+	bool Weights::TrySelectTeam(int size, WeightsData& result) const
+	{
+		auto dataIt = weightsMap.find(std::to_string(size) + "v");
+		if (dataIt == weightsMap.end()) return false;
+		result = dataIt->second;
+		return true;
 	}
 
 	void Weights::Load(const std::string& file, Weights& result)
+	{
+		std::string error;
+		if (!TryLoad(file, result, error))
+		{
+			CW_FATAL(error);
+		}
+	}
+
+	bool Weights::TryLoad(const std::string& file, Weights& result, std::string& error)
 	{
 		result.weightsMap.clear();
 		try
@@ -81,7 +125,8 @@ namespace CWTeams
 				double sum = pvpWeight + gamesenseWeight + teamworkWeight;
 				if (sum != 1.0)
 				{
-					CW_FATAL("Weights don't sum to 1! In situation row \"{}\" pvp: {}, gamesense: {}, teamwork: {} Sum to: {}!", situation, pvpWeight, gamesenseWeight, teamworkWeight, sum);
+					throw std::runtime_error(fmt::format("Weights don't sum to 1! In situation row \"{}\" pvp: {}, gamesense: {}, teamwork: {} Sum to: {}!",
+						situation, pvpWeight, gamesenseWeight, teamworkWeight, sum));
 				}
 				CW_SUCCESS("Read situation weights: \"{}\" = pvp: {}, gamesense: {}, teamwork: {}", situation, pvpWeight, gamesenseWeight, teamworkWeight);
 				result.weightsMap[situation] = WeightsData { pvpWeight, gamesenseWeight, teamworkWeight };
@@ -91,8 +136,14 @@ namespace CWTeams
 		}
 		catch (std::exception& e)
 		{
-			CW_FATAL("Exception raised while parsing weights file {}: {}", file, e.what());
+			error = "Exception raised while parsing weights file " + file + ": " + e.what();
+			return false;
 		}
+		return true;
 	}
 
-}
\ No newline at end of file
+	void Weights::Add(const std::string& situation, const WeightsData& weights)
+	{
+		weightsMap[situation] = weights;
+	}
+}
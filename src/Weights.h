@@ -14,10 +14,26 @@ namespace CWTeams
 	public:
 		WeightsData Select(const TeamSizes& teamSizes);
 
+		//Like Select but returns false instead of exiting when there are no weights for the situation
+		bool TrySelect(const TeamSizes& teamSizes, WeightsData& result) const;
+
+		//The weights for a single team of size players, the "4v" style situations. Returns false if there are none
+		bool TrySelectTeam(int size, WeightsData& result) const;
+
 		static void Load(const std::string& file, Weights& result);
+		//Like Load but returns false with the reason in error instead of exiting when the workbook can't be read
+		static bool TryLoad(const std::string& file, Weights& result, std::string& error);
+
+		//Adds the weights for a situation like "4v4v4" or "4v" without a spreadsheet
+		void Add(const std::string& situation, const WeightsData& weights);
 
 	private:
 		std::map<std::string, WeightsData> weightsMap;
 
+		//The situation name for the team sizes, like "4v4v3"
+		static std::string GetSituation(const TeamSizes& teamSizes);
+		//Also returns the last situation that was looked up
+		bool TrySelect(const TeamSizes& teamSizes, WeightsData& result, std::string& query) const;
+
 	};
 }
\ No newline at end of file
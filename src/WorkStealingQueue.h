@@ -0,0 +1,51 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace CWTeams
+{
+
+	//Per worker task deque. The owner pushes and pops at the back so it keeps working depth first on small, cache warm subtrees,
+	//while other workers steal from the front where the oldest and therefore biggest subtrees are
+	template<typename T>
+	class WorkStealingQueue
+	{
+	public:
+		void Push(T&& task)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			tasks.push_back(std::move(task));
+		}
+
+		bool Pop(T& result)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (tasks.empty()) return false;
+			result = std::move(tasks.back());
+			tasks.pop_back();
+			return true;
+		}
+
+		bool Steal(T& result)
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			if (tasks.empty()) return false;
+			result = std::move(tasks.front());
+			tasks.pop_front();
+			return true;
+		}
+
+		bool Empty()
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			return tasks.empty();
+		}
+
+	private:
+		std::mutex lock;
+		std::deque<T> tasks;
+
+	};
+}